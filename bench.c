@@ -0,0 +1,355 @@
+/*
+ * elastictab: a simple implementation of elastic tabstops in C
+ * Copyright (C) 2014  Benjamin Block (bebl@mageta.org)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "errno.h"
+#include "string.h"
+#include "stdint.h"
+#include "time.h"
+#include "unistd.h"
+#include "sys/resource.h"
+#include "sys/types.h"
+#include "sys/wait.h"
+
+#include "elastictab.h"
+
+/*
+ * Benchmarks for the library
+ *
+ * Each workload is a synthetic table that is generated up front. It is then
+ * added, rendered into a buffer and printed into /dev/null, each phase timed
+ * on its own. The printf-workload adds its lines with
+ * `elastic_print_add_printf()` instead. Each workload runs in a child process
+ * of its own, so the peak RSS it reports is its own.
+ *
+ * The binary is linked with `-Wl,--wrap=malloc` (and calloc, realloc), so
+ * all allocations made by the library (and this file) are counted.
+ */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static size_t bench_allocs;
+
+void *__wrap_malloc(size_t size)
+{
+	bench_allocs += 1;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	bench_allocs += 1;
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	bench_allocs += 1;
+	return __real_realloc(ptr, size);
+}
+
+/** one synthetic table */
+struct bench_workload
+{
+	const char *	name;
+	/** number of lines */
+	size_t		lines;
+	/** number of tab-separated cells per line */
+	size_t		cells;
+	/** each line has between 1 and `cells` cells, instead of exactly
+	 * `cells` */
+	int		ragged;
+	/** maximum width of a cell */
+	size_t		width;
+	/** the lines are added with `elastic_print_add_printf()` */
+	int		printf;
+};
+
+static const struct bench_workload bench_workloads[] = {
+	{ "narrow",	 1 << 20,  3,	  0, 8,	 0 },
+	{ "wide",	 1 << 16,  64,	  0, 16, 0 },
+	{ "short-lines", 1 << 22,  1,	  0, 4,	 0 },
+	{ "huge-lines",	 1 << 4,   1 << 16, 0, 16, 0 },
+	{ "ragged",	 1 << 20,  12,	  1, 12, 0 },
+	{ "printf",	 1 << 20,  4,	  0, 0,	 1 },
+};
+
+static uint64_t bench_random_state = 0x9e3779b97f4a7c15ull;
+
+/** xorshift64*, so each run measures the same input */
+static size_t bench_random(size_t range)
+{
+	bench_random_state ^= bench_random_state >> 12;
+	bench_random_state ^= bench_random_state << 25;
+	bench_random_state ^= bench_random_state >> 27;
+
+	return (size_t) ((bench_random_state * 0x2545f4914f6cdd1dull) >> 32) %
+	       range;
+}
+
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + ((double) ts.tv_nsec / 1e9);
+}
+
+/** generates the table of `workload` with `lines` lines into `*buffer` */
+static int bench_generate(const struct bench_workload *workload, size_t lines,
+			  char **buffer, size_t *length)
+{
+	size_t size, line, cell, cells, width;
+	char *cur;
+
+	size = lines * workload->cells * (workload->width + 1) + 1;
+	*buffer = malloc(size);
+	if (*buffer == NULL) {
+		return ENOMEM;
+	}
+
+	cur = *buffer;
+	for (line = 0; line < lines; line++) {
+		cells = workload->cells;
+		if (workload->ragged) {
+			cells = 1 + bench_random(cells);
+		}
+
+		for (cell = 0; cell < cells; cell++) {
+			width = bench_random(workload->width + 1);
+			memset(cur, 'a' + (int) (cell % 26), width);
+			cur += width;
+			*cur++ = ((cell + 1) < cells) ? '\t' : '\n';
+		}
+	}
+	*cur = '\0';
+
+	*length = (size_t) (cur - *buffer);
+	return 0;
+}
+
+/** adds `lines` lines of four formatted cells with
+ * `elastic_print_add_printf()`
+ *
+ * \para length	set to the number of formatted bytes that were added
+ */
+static int bench_add_printf(struct elastic_print *eprint, size_t lines,
+			    size_t *length)
+{
+	size_t line, added = eprint->stats.bytes_added;
+	int rc;
+
+	for (line = 0; line < lines; line++) {
+		rc = elastic_print_add_printf(eprint, "%zu\t%s\t%08zx\t%.3f",
+					      line, (line % 3) ? "b" : "ccccc",
+					      line * 2654435761u,
+					      (double) line / 7.0);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	*length = eprint->stats.bytes_added - added;
+	return 0;
+}
+
+static void bench_report(const char *workload, const char *phase,
+			 size_t bytes, size_t lines, double seconds,
+			 size_t allocs)
+{
+	if (seconds <= 0.0) {
+		seconds = 1e-9;
+	}
+
+	fprintf(stdout, "%-12s %-10s %10.1f MB/s %12.0f lines/s %10zu allocs\n",
+		workload, phase, ((double) bytes / 1e6) / seconds,
+		(double) lines / seconds, allocs);
+}
+
+static int bench_run(const struct bench_workload *workload, size_t scale)
+{
+	int rc;
+
+	struct elastic_print ep;
+	struct rusage usage;
+	char *input = NULL, *output;
+	size_t lines, length, output_length, allocs;
+	double start;
+	FILE *null;
+
+	lines = workload->lines / scale;
+	if (lines == 0) {
+		lines = 1;
+	}
+
+	rc = elastic_print_create_flags(&ep, 0, 1, ELASTIC_PRINT_DYNAMIC);
+	if (rc != 0) {
+		goto err;
+	}
+
+	allocs = bench_allocs;
+	start = bench_now();
+
+	if (workload->printf) {
+		rc = bench_add_printf(&ep, lines, &length);
+		if (rc != 0) {
+			goto err_destroy_ep;
+		}
+
+		bench_report(workload->name, "add_printf", length, lines,
+			     bench_now() - start, bench_allocs - allocs);
+	} else {
+		rc = bench_generate(workload, lines, &input, &length);
+		if (rc != 0) {
+			goto err_destroy_ep;
+		}
+
+		allocs = bench_allocs;
+		start = bench_now();
+
+		rc = elastic_print_add_line(&ep, input, length);
+		if (rc != 0) {
+			goto err_free_input;
+		}
+
+		bench_report(workload->name, "add_line", length, lines,
+			     bench_now() - start, bench_allocs - allocs);
+	}
+
+	output_length = elastic_print_measure(&ep);
+	output = malloc(output_length + 1);
+	if (output == NULL) {
+		rc = ENOMEM;
+		goto err_free_input;
+	}
+
+	allocs = bench_allocs;
+	start = bench_now();
+
+	rc = elastic_print_snput(&ep, output, output_length + 1);
+	if (rc < 0) {
+		rc = -rc;
+		goto err_free_output;
+	}
+
+	bench_report(workload->name, "snput", output_length, lines,
+		     bench_now() - start, bench_allocs - allocs);
+
+	null = fopen("/dev/null", "w");
+	if (null == NULL) {
+		rc = errno;
+		goto err_free_output;
+	}
+
+	allocs = bench_allocs;
+	start = bench_now();
+
+	rc = elastic_print_fput(&ep, null);
+	fclose(null);
+	if (rc != 0) {
+		goto err_free_output;
+	}
+
+	bench_report(workload->name, "fput", output_length, lines,
+		     bench_now() - start, bench_allocs - allocs);
+
+	/* this runs in a child of its own, see `bench_fork()` */
+	getrusage(RUSAGE_SELF, &usage);
+	fprintf(stdout, "%-12s peak RSS   %10ld KiB\n", workload->name,
+		usage.ru_maxrss);
+
+	rc = 0;
+err_free_output:
+	free(output);
+err_free_input:
+	free(input);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	return rc;
+}
+
+/** runs `workload` in a forked child, so the peak RSS it reports doesn't
+ * include the memory of the workloads before it
+ *
+ * \returns the return code of `bench_run()` in the child, or an errno if the
+ *	    child could not be run
+ */
+static int bench_fork(const struct bench_workload *workload, size_t scale)
+{
+	pid_t pid;
+	int status;
+
+	/* the child would print what is still buffered once more */
+	fflush(stdout);
+
+	pid = fork();
+	if (pid < 0) {
+		return errno;
+	}
+
+	if (pid == 0) {
+		status = bench_run(workload, scale);
+		fflush(stdout);
+		_exit(status);
+	}
+
+	if (waitpid(pid, &status, 0) < 0) {
+		return errno;
+	}
+
+	if (!WIFEXITED(status)) {
+		return ECHILD;
+	}
+
+	return WEXITSTATUS(status);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int rc;
+	size_t i, scale = 1;
+
+	/* a scale of n runs each workload with 1/n of its lines */
+	if (argc > 1) {
+		scale = (size_t) strtoul(argv[1], NULL, 10);
+		if (scale == 0) {
+			fprintf(stderr, "usage: %s [SCALE]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (i = 0; i < (sizeof(bench_workloads) / sizeof(*bench_workloads));
+	     i++) {
+		rc = bench_fork(&bench_workloads[i], scale);
+		if (rc != 0) {
+			fprintf(stderr, "workload '%s' failed: %s\n",
+				bench_workloads[i].name, strerror(rc));
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
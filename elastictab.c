@@ -17,6 +17,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#define _XOPEN_SOURCE 700
+
 #include "elastictab.h"
 
 #include "stdio.h"
@@ -25,432 +27,4548 @@
 #include "errno.h"
 #include "assert.h"
 #include "stdint.h"
-#include "ctype.h"
 #include "stdarg.h"
+#include "time.h"
+#include "limits.h"
+#include "unistd.h"
+#include "pthread.h"
+#include "sys/uio.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include "immintrin.h"
+#endif
+
+/** size of a regular storage-chunk in `struct elastic_print::chunks` */
+#define ELASTIC_PRINT_CHUNK_SIZE	(1 << 16)
+/** number of slots `struct elastic_print::lines` starts with */
+#define ELASTIC_PRINT_LINES_START	(1 << 4)
+
+/** smallest part of the input (or output) a thread is started for in
+ * `elastic_print_add_bulk()` (or `elastic_print_snput_threads()`) */
+#ifndef ELASTIC_PRINT_BULK_MIN
+#define ELASTIC_PRINT_BULK_MIN		(1 << 20)
+#endif
+/** most threads `elastic_print_add_bulk()` uses */
+#define ELASTIC_PRINT_BULK_THREADS	64
+
+/** amount of output collected in streaming mode before it is written */
+#define ELASTIC_PRINT_STREAM_FLUSH	(1 << 16)
+
+/** environment-variable that makes `elastic_print_destory()` print the
+ * statistics of each instance to stderr, if it is set and not empty */
+#define ELASTIC_PRINT_STATS_ENV		"ELASTICTAB_STATS"
+
+/** size of the blocks `elastic_print_sinkput()` hands to its sink */
+#define ELASTIC_PRINT_SINK_BLOCK	(1 << 16)
+
+/** number of `struct iovec` handed to one `writev()` call */
+#if defined(IOV_MAX) && (IOV_MAX < 1024)
+#define ELASTIC_PRINT_IOVECS		IOV_MAX
+#else
+#define ELASTIC_PRINT_IOVECS		1024
+#endif
+
+#define __spaces16	"                "
+#define __spaces64	__spaces16 __spaces16 __spaces16 __spaces16
+
+/** run of spaces all padding is taken from in `elastic_print_fdput()` */
+static const char elastic_print_spaces[] =
+    __spaces64 __spaces64 __spaces64 __spaces64;
+static const char elastic_print_newline[] = "\n";
+
+/** one chunk of the line storage in `struct elastic_print::chunks` */
+struct elastic_print_chunk
+{
+	/** next (older) chunk in the list */
+	struct elastic_print_chunk *	next;
+	/** number of bytes usable in `data` */
+	size_t				size;
+	/** number of bytes in `data` that are already handed out */
+	size_t				used;
+	/** number of the handed out bytes that belonged to lines, which were
+	 * replaced or removed since, see `elastic_print_chunk_release()` */
+	size_t				dead;
+	char				data[];
+};
+
+/** widths of the column blocks of one column, see `ELASTIC_PRINT_BLOCKS` */
+struct elastic_print_blocks
+{
+	/** width of each block, in the order of their lines */
+	size_t *	widths;
+	/** number of blocks in `widths` */
+	size_t		count;
+	/** number of slots allocated for `widths` */
+	size_t		size;
+};
+
+/** widths wanted by the cells of one column, see `ELASTIC_PRINT_UPDATE` */
+struct elastic_print_histogram
+{
+	/** number of cells that want each width */
+	size_t *	counts;
+	/** number of elements allocated for `counts` (> widest cell) */
+	size_t		size;
+};
+
+/** one run of lines added by a single call, see `ELASTIC_PRINT_CONCURRENT` */
+struct elastic_print_run
+{
+	/** number the call took from the global sequence */
+	uint64_t	seq;
+	/** index behind the last line of the run in its shard */
+	size_t		end;
+};
+
+/** lines added by one thread, see `ELASTIC_PRINT_CONCURRENT` */
+struct elastic_print_shard
+{
+	/** private instance with the same settings as the target */
+	struct elastic_print		eprint;
+	/** runs of lines in `eprint`, in the order they were added */
+	struct elastic_print_run *	runs;
+	size_t				runs_count;
+	size_t				runs_size;
+	/** number of `runs` already merged by `elastic_print_gather()` */
+	size_t				runs_merged;
+	/** next shard of the same instance */
+	struct elastic_print_shard *	next;
+};
+
+/** state of a instance in concurrent mode, see `ELASTIC_PRINT_CONCURRENT` */
+struct elastic_print_concurrent
+{
+	/** holds the shard of each thread */
+	pthread_key_t			key;
+	/** all shards of the instance, new ones are pushed atomically */
+	struct elastic_print_shard *	shards;
+	/** next number of the global sequence */
+	uint64_t			seq;
+	/** width of the widest cell (with its tab) published for each
+	 * column, only ever raised with atomic operations */
+	size_t *			widths;
+	/** number of elements in `widths` (`columns_max` of the instance) */
+	size_t				columns;
+};
+
+/** a file mapped by `elastic_print_add_fd()`, borrowed lines point into it */
+struct elastic_print_mapping
+{
+	/** next (older) mapping of the same instance */
+	struct elastic_print_mapping *	next;
+	void *				addr;
+	size_t				length;
+};
+
+/** state of a instance in spill mode, see `elastic_print_spill()` */
+struct elastic_print_spill
+{
+	/** unlinked temporary file the stored lines are appended to */
+	int		fd;
+	/** bytes of stored lines held in memory before they are spilled */
+	size_t		budget;
+	/** bytes of the stored lines that are not in the file yet */
+	size_t		pending;
+	/** number of lines, from the first one on, that are in the file */
+	size_t		lines;
+	/** number of bytes written to the file */
+	size_t		size;
+	/** mapping of the first `mapped` bytes of the file, which the
+	 * spilled `lines` point into once they are rendered; NULL if nothing
+	 * is mapped yet */
+	char *		map;
+	size_t		mapped;
+};
+
+/** returns a monotonic timestamp in nanoseconds, for the statistics */
+static uint64_t elastic_print_clock(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+		return 0;
+	}
+
+	return ((uint64_t) ts.tv_sec * 1000000000u) + (uint64_t) ts.tv_nsec;
+}
+
+/** grows the output of `eprint` by `cells` times `width` characters
+ *
+ * The widths of many cells can add up to more than fits a `size_t` (mostly
+ * on 32 bit), so this is checked; once it happened `output_length` isn't
+ * exact anymore and `output_overflow` stays set until the instance is reset.
+ */
+static inline void elastic_print_output_grow(struct elastic_print *eprint,
+					     size_t cells, size_t width)
+{
+	size_t grow;
+
+	if (__builtin_mul_overflow(cells, width, &grow) ||
+	    __builtin_add_overflow(eprint->output_length, grow,
+				   &eprint->output_length)) {
+		eprint->output_overflow = 1;
+	}
+}
+
+/** returns a storage-chunk with room for at least `size` bytes, that is
+ * not in use yet
+ *
+ * The smallest spare chunk that is big enough is taken, only if there is
+ * none a new one is allocated.
+ *
+ * \returns NULL	in case no memory could be allocated
+ */
+static struct elastic_print_chunk *elastic_print_chunk_new(
+    struct elastic_print *eprint, size_t size)
+{
+	struct elastic_print_chunk *chunk, **spare, **best = NULL;
+
+	for (spare = &(eprint->chunks_spare); *spare != NULL;
+	     spare = &((*spare)->next)) {
+		if (((*spare)->size >= size) &&
+		    ((best == NULL) || ((*spare)->size < (*best)->size))) {
+			best = spare;
+		}
+	}
+
+	if (best != NULL) {
+		chunk = *best;
+		*best = chunk->next;
+	} else {
+		if (size > (SIZE_MAX - sizeof(*chunk))) {
+			return NULL;
+		}
+
+		chunk = malloc(sizeof(*chunk) + size);
+		if (chunk == NULL) {
+			return NULL;
+		}
+		eprint->stats.allocs += 1;
+		eprint->stats.bytes_storage += size;
+
+		chunk->size = size;
+	}
+
+	chunk->used = 0;
+	chunk->dead = 0;
+	return chunk;
+}
+
+/** reserves `size` bytes in the line storage of `eprint`
+ *
+ * Requests that don't fit into the newest chunk anymore will start a new
+ * chunk. Requests that are larger than half a regular chunk get a chunk of
+ * their own, that is put behind the newest one, so the space left in there
+ * can still be used by the following requests.
+ *
+ * \returns NULL	in case no memory could be allocated
+ */
+static char *elastic_print_chunk_alloc(struct elastic_print *eprint,
+				       size_t size)
+{
+	struct elastic_print_chunk *chunk = eprint->chunks;
+	size_t chunk_size = ELASTIC_PRINT_CHUNK_SIZE;
+
+	if ((chunk != NULL) && ((chunk->size - chunk->used) >= size)) {
+		chunk->used += size;
+		return &(chunk->data[chunk->used - size]);
+	}
+
+	if (size > (chunk_size / 2)) {
+		chunk_size = size;
+	}
+
+	chunk = elastic_print_chunk_new(eprint, chunk_size);
+	if (chunk == NULL) {
+		return NULL;
+	}
+	chunk->used = size;
+
+	if ((size > (ELASTIC_PRINT_CHUNK_SIZE / 2)) && (eprint->chunks != NULL)) {
+		chunk->next = eprint->chunks->next;
+		eprint->chunks->next = chunk;
+	} else {
+		chunk->next = eprint->chunks;
+		eprint->chunks = chunk;
+	}
+
+	return &(chunk->data[0]);
+}
+
+/** returns the chunk `stored` lies in, that was just handed out by
+ * `elastic_print_chunk_alloc()` */
+static struct elastic_print_chunk *elastic_print_chunk_owner(
+    struct elastic_print *eprint, const char *stored)
+{
+	struct elastic_print_chunk *chunk = eprint->chunks;
+
+	/* large requests are put behind the newest chunk */
+	if (((uintptr_t) stored < (uintptr_t) chunk->data) ||
+	    ((uintptr_t) stored >= ((uintptr_t) chunk->data + chunk->size))) {
+		chunk = chunk->next;
+	}
+
+	return chunk;
+}
+
+/** returns at least `size` bytes of free space in the newest storage-chunk
+ * of `eprint`, without handing them out yet
+ *
+ * If the newest chunk has not enough space left, a new one is started. The
+ * next calls to `elastic_print_chunk_alloc()` hand out the same space again,
+ * as long as they don't ask for more than was reserved.
+ *
+ * \returns NULL	in case no memory could be allocated
+ */
+static char *elastic_print_chunk_reserve(struct elastic_print *eprint,
+					 size_t size)
+{
+	struct elastic_print_chunk *chunk = eprint->chunks;
+	size_t chunk_size = ELASTIC_PRINT_CHUNK_SIZE;
+
+	if ((chunk != NULL) && ((chunk->size - chunk->used) >= size)) {
+		return &(chunk->data[chunk->used]);
+	}
+
+	if (size > chunk_size) {
+		chunk_size = size;
+	}
+
+	chunk = elastic_print_chunk_new(eprint, chunk_size);
+	if (chunk == NULL) {
+		return NULL;
+	}
+	chunk->next = eprint->chunks;
+	eprint->chunks = chunk;
+
+	return &(chunk->data[0]);
+}
+
+/** makes sure `eprint->lines` has room for at least `count` more lines
+ *
+ * The index grows geometrically, so adding n lines costs O(n) copies.
+ *
+ * \returns ENOMEM	in case the index could not be grown
+ * \returns 0		if everything went OK
+ */
+static int elastic_print_lines_reserve(struct elastic_print *eprint,
+				       size_t count)
+{
+	void *grown;
+	size_t lines_size;
+
+	if (count <= (eprint->lines_size - eprint->lines_count)) {
+		return 0;
+	}
+	if (count > (SIZE_MAX - eprint->lines_count)) {
+		return ENOMEM;
+	}
+
+	lines_size = (eprint->lines_size > 0) ? eprint->lines_size :
+						ELASTIC_PRINT_LINES_START;
+	while (lines_size < (eprint->lines_count + count)) {
+		if (lines_size > ((SIZE_MAX / sizeof(size_t)) / 2)) {
+			return ENOMEM;
+		}
+		lines_size *= 2;
+	}
+
+#define __grow_lines(array)                                                    \
+	{                                                                      \
+		grown = realloc(eprint->array,                                 \
+				lines_size * sizeof(*eprint->array));          \
+		if (grown == NULL) {                                           \
+			return ENOMEM;                                         \
+		}                                                              \
+		eprint->array = grown;                                         \
+		eprint->stats.reallocs += 1;                                   \
+	}
+
+	__grow_lines(lines);
+	__grow_lines(lines_length);
+	__grow_lines(lines_cells);
+	__grow_lines(lines_cells_first);
+	if (eprint->histograms != NULL) {
+		__grow_lines(lines_chunk);
+	}
+
+#undef __grow_lines
+
+	eprint->lines_size = lines_size;
+
+	return 0;
+}
+
+/** makes sure the cell index has room for at least `count` more cells
+ *
+ * \returns ENOMEM	in case the cell index could not be grown
+ * \returns 0		if everything went OK
+ */
+static int elastic_print_cells_reserve(struct elastic_print *eprint,
+				       size_t count)
+{
+	void *grown;
+	size_t cells_size;
+
+	if (count <= (eprint->cells_size - eprint->cells_count)) {
+		return 0;
+	}
+	if (count > (SIZE_MAX - eprint->cells_count)) {
+		return ENOMEM;
+	}
+
+	cells_size = (eprint->cells_size > 0) ? eprint->cells_size :
+						ELASTIC_PRINT_LINES_START;
+	while (cells_size < (eprint->cells_count + count)) {
+		if (cells_size > ((SIZE_MAX / sizeof(size_t)) / 2)) {
+			return ENOMEM;
+		}
+		cells_size *= 2;
+	}
+
+#define __grow_cells(array)                                                    \
+	{                                                                      \
+		grown = realloc(eprint->array,                                 \
+				cells_size * sizeof(*eprint->array));          \
+		if (grown == NULL) {                                           \
+			return ENOMEM;                                         \
+		}                                                              \
+		eprint->array = grown;                                         \
+		eprint->stats.reallocs += 1;                                   \
+	}
+
+	__grow_cells(cells_length);
+	__grow_cells(cells_width);
+
+#undef __grow_cells
+
+	eprint->cells_size = cells_size;
+
+	return 0;
+}
+
+/** makes sure the blocks of `column` have room for at least one more block
+ *
+ * \returns ENOMEM	in case the blocks could not be grown
+ * \returns 0		if everything went OK
+ */
+static int elastic_print_blocks_reserve(struct elastic_print *eprint,
+					size_t column)
+{
+	struct elastic_print_blocks *blocks = &(eprint->blocks[column]);
+	size_t *widths;
+	size_t size;
+
+	if (blocks->count < blocks->size) {
+		return 0;
+	}
+
+	if (blocks->size == 0) {
+		size = ELASTIC_PRINT_LINES_START;
+	} else if (blocks->size > ((SIZE_MAX / sizeof(*widths)) / 2)) {
+		return ENOMEM;
+	} else {
+		size = blocks->size * 2;
+	}
+
+	widths = realloc(blocks->widths, size * sizeof(*widths));
+	if (widths == NULL) {
+		return ENOMEM;
+	}
+	eprint->stats.reallocs += 1;
+
+	blocks->widths = widths;
+	blocks->size = size;
+
+	return 0;
+}
+
+/** accounts the elastic cells of the newest line to the column blocks
+ *
+ * \para eprint		current elastictab instance
+ * \para cells		number of elastic cells in the newest line
+ *
+ * \returns ENOMEM	in case a new block could not be stored
+ * \returns 0		if everything went OK
+ *
+ * Each cell either continues the block of its column, if the line before
+ * had a cell in this column as well, or starts a new block. Nothing is
+ * changed if an error is returned.
+ */
+static int elastic_print_blocks_add(struct elastic_print *eprint,
+				    size_t cells)
+{
+	struct elastic_print_blocks *blocks;
+	size_t prev, column, len, *width, *cells_width;
+	int rc;
+
+	cells_width = &(eprint->cells_width[eprint->cells_count]);
+
+	prev = 0;
+	if (eprint->lines_count > 1) {
+		prev = eprint->lines_cells[eprint->lines_count - 2];
+	}
+
+	for (column = prev; column < cells; column++) {
+		rc = elastic_print_blocks_reserve(eprint, column);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	for (column = 0; column < cells; column++) {
+		blocks = &(eprint->blocks[column]);
+
+		if (column >= prev) {
+			blocks->widths[blocks->count] =
+			    eprint->column_widths_min;
+			blocks->count += 1;
+			eprint->column_cells[column] = 0;
+		}
+
+		width = &(blocks->widths[blocks->count - 1]);
+		len = cells_width[column] + 1;
+
+		if (*width < len) {
+			elastic_print_output_grow(eprint,
+						  eprint->column_cells[column],
+						  len - *width);
+			*width = len;
+		}
+		if (eprint->column_widths[column] < len) {
+			eprint->column_widths[column] = len;
+		}
+
+		eprint->column_cells[column] += 1;
+		elastic_print_output_grow(eprint, 1, *width - len);
+	}
+
+	return 0;
+}
+
+/** moves the block-cursors on to `line` while rendering
+ *
+ * \para cursor		number of blocks started in each column so far, or
+ *			NULL if the instance doesn't use column blocks
+ */
+static inline void elastic_print_cursor_step(const struct elastic_print *eprint,
+					     size_t *cursor, size_t line)
+{
+	size_t column, prev;
+
+	if (cursor == NULL) {
+		return;
+	}
+
+	prev = (line > 0) ? eprint->lines_cells[line - 1] : 0;
+	for (column = prev; column < eprint->lines_cells[line]; column++) {
+		cursor[column] += 1;
+	}
+}
+
+/** returns the elastic width of `column` in the line the cursors are at */
+static inline size_t elastic_print_cursor_width(
+    const struct elastic_print *eprint, const size_t *cursor, size_t column)
+{
+	if (cursor == NULL) {
+		return eprint->column_widths[column];
+	}
+
+	return eprint->blocks[column].widths[cursor[column] - 1];
+}
+
+/** returns the cursors needed to render `eprint` with
+ * `elastic_print_cursor_step()`, all set to 0
+ *
+ * The cursors belong to `eprint` (see `render_cursor`) and are reused by the
+ * next render, they MUST not be freed.
+ *
+ * \returns 0		in case everything went OK, `*cursor` might be NULL
+ *			if the instance doesn't use column blocks
+ * \returns ENOMEM	in case the cursors could not be allocated
+ */
+static int elastic_print_cursor_alloc(struct elastic_print *eprint,
+				      size_t **cursor)
+{
+	*cursor = NULL;
+
+	if (eprint->blocks == NULL) {
+		return 0;
+	}
+
+	if (eprint->render_cursor_size < (eprint->columns + 1)) {
+		free(eprint->render_cursor);
+		eprint->render_cursor_size = 0;
+
+		eprint->render_cursor =
+		    calloc(eprint->columns_size + 1, sizeof(**cursor));
+		if (eprint->render_cursor == NULL) {
+			return ENOMEM;
+		}
+		eprint->stats.allocs += 1;
+		eprint->render_cursor_size = eprint->columns_size + 1;
+	} else {
+		memset(eprint->render_cursor, 0,
+		       (eprint->columns + 1) * sizeof(**cursor));
+	}
+
+	*cursor = eprint->render_cursor;
+	return 0;
+}
+
+/** makes sure `eprint` has at least `columns` columns
+ *
+ * New columns start with the minimum width and without any cells. The
+ * per-column arrays grow geometrically.
+ *
+ * \returns ENOMEM	in case the arrays could not be grown
+ * \returns 0		if everything went OK
+ */
+static int elastic_print_columns_reserve(struct elastic_print *eprint,
+					 size_t columns)
+{
+	struct elastic_print_blocks *blocks;
+	struct elastic_print_histogram *histograms;
+	size_t *widths, *cells;
+	size_t size, i;
+
+	if (columns <= eprint->columns) {
+		return 0;
+	}
+
+	if (columns > eprint->columns_size) {
+		size = (eprint->columns_size > 0) ? eprint->columns_size :
+						    ELASTIC_PRINT_LINES_START;
+		while (size < columns) {
+			if (size > ((SIZE_MAX / sizeof(*blocks)) / 2)) {
+				return ENOMEM;
+			}
+			size *= 2;
+		}
+
+		widths = realloc(eprint->column_widths, size * sizeof(*widths));
+		if (widths == NULL) {
+			return ENOMEM;
+		}
+		eprint->column_widths = widths;
+
+		cells = realloc(eprint->column_cells, size * sizeof(*cells));
+		if (cells == NULL) {
+			return ENOMEM;
+		}
+		eprint->column_cells = cells;
+		eprint->stats.reallocs += 2;
+
+		if (eprint->blocks != NULL) {
+			blocks = realloc(eprint->blocks, size * sizeof(*blocks));
+			if (blocks == NULL) {
+				return ENOMEM;
+			}
+			eprint->stats.reallocs += 1;
+			memset(&blocks[eprint->columns_size], 0,
+			       (size - eprint->columns_size) * sizeof(*blocks));
+			eprint->blocks = blocks;
+		}
+
+		if (eprint->histograms != NULL) {
+			histograms = realloc(eprint->histograms,
+					     size * sizeof(*histograms));
+			if (histograms == NULL) {
+				return ENOMEM;
+			}
+			eprint->stats.reallocs += 1;
+			memset(&histograms[eprint->columns_size], 0,
+			       (size - eprint->columns_size) *
+				   sizeof(*histograms));
+			eprint->histograms = histograms;
+		}
+
+		eprint->columns_size = size;
+	}
+
+	for (i = eprint->columns; i < columns; i++) {
+		eprint->column_widths[i] = eprint->column_widths_min;
+		eprint->column_cells[i] = 0;
+	}
+	eprint->columns = columns;
+
+	return 0;
+}
+
+/** switches `eprint` (without any lines yet) to column blocks */
+static int elastic_print_blocks_enable(struct elastic_print *eprint)
+{
+	if (eprint->blocks != NULL) {
+		return 0;
+	}
+
+	eprint->blocks =
+	    calloc(eprint->columns_size + 1, sizeof(*eprint->blocks));
+	if (eprint->blocks == NULL) {
+		return ENOMEM;
+	}
+	eprint->stats.allocs += 1;
+
+	return 0;
+}
+
+/** switches `eprint` (without any lines yet) to keeping width histograms */
+static int elastic_print_histograms_enable(struct elastic_print *eprint)
+{
+	eprint->histograms =
+	    calloc(eprint->columns_size + 1, sizeof(*eprint->histograms));
+	if (eprint->histograms == NULL) {
+		return ENOMEM;
+	}
+	eprint->stats.allocs += 1;
+
+	return 0;
+}
+
+/** switches `eprint` (without any lines yet) to concurrent mode */
+static int elastic_print_concurrent_enable(struct elastic_print *eprint)
+{
+	struct elastic_print_concurrent *concurrent;
+	size_t i;
+	int rc;
+
+	concurrent = calloc(1, sizeof(*concurrent));
+	if (concurrent == NULL) {
+		return ENOMEM;
+	}
+	eprint->stats.allocs += 1;
+
+	concurrent->columns = eprint->columns_max;
+	if (concurrent->columns > 0) {
+		concurrent->widths =
+		    calloc(concurrent->columns, sizeof(*concurrent->widths));
+		if (concurrent->widths == NULL) {
+			rc = ENOMEM;
+			goto err_free_concurrent;
+		}
+		eprint->stats.allocs += 1;
+	}
+
+	for (i = 0; i < concurrent->columns; i++) {
+		concurrent->widths[i] = eprint->column_widths_min;
+	}
+
+	rc = pthread_key_create(&concurrent->key, NULL);
+	if (rc != 0) {
+		goto err_free_widths;
+	}
+
+	eprint->concurrent = concurrent;
+	return 0;
+err_free_widths:
+	free(concurrent->widths);
+err_free_concurrent:
+	free(concurrent);
+	return rc;
+}
+
+/** makes sure the histogram of `column` can count cells of `width`
+ *
+ * \returns ENOMEM	in case the histogram could not be grown
+ * \returns 0		if everything went OK
+ */
+static int elastic_print_histogram_reserve(struct elastic_print *eprint,
+					   size_t column, size_t width)
+{
+	struct elastic_print_histogram *histogram =
+	    &(eprint->histograms[column]);
+	size_t *counts;
+	size_t size;
+
+	if (width < histogram->size) {
+		return 0;
+	}
+
+	size = (histogram->size > 0) ? histogram->size :
+				       ELASTIC_PRINT_LINES_START;
+	while (size <= width) {
+		if (size > ((SIZE_MAX / sizeof(*counts)) / 2)) {
+			return ENOMEM;
+		}
+		size *= 2;
+	}
+
+	counts = realloc(histogram->counts, size * sizeof(*counts));
+	if (counts == NULL) {
+		return ENOMEM;
+	}
+	eprint->stats.reallocs += 1;
+	memset(&counts[histogram->size], 0,
+	       (size - histogram->size) * sizeof(*counts));
+
+	histogram->counts = counts;
+	histogram->size = size;
+
+	return 0;
+}
+
+/** takes one cell of `width` out of the histogram of `column`
+ *
+ * If it was the last of the widest cells, the column shrinks to the next
+ * width that is still wanted (or the minimum).
+ */
+static void elastic_print_histogram_remove(struct elastic_print *eprint,
+					   size_t column, size_t width)
+{
+	struct elastic_print_histogram *histogram =
+	    &(eprint->histograms[column]);
+	size_t widest = eprint->column_widths[column];
+
+	assert((width < histogram->size) && (histogram->counts[width] > 0));
+	histogram->counts[width] -= 1;
+
+	if ((width != widest) || (histogram->counts[width] > 0)) {
+		return;
+	}
+
+	while ((widest > eprint->column_widths_min) &&
+	       (histogram->counts[widest] == 0)) {
+		widest -= 1;
+	}
+
+	eprint->output_length -= eprint->column_cells[column] *
+				 (eprint->column_widths[column] - widest);
+	eprint->column_widths[column] = widest;
+}
+
+/** moves all storage-chunks of `eprint` but the newest one to the spare
+ * chunks, the lines in them MUST not be used anymore */
+static void elastic_print_chunks_recycle(struct elastic_print *eprint)
+{
+	struct elastic_print_chunk *chunk;
+
+	if (eprint->chunks == NULL) {
+		return;
+	}
+
+	while (eprint->chunks->next != NULL) {
+		chunk = eprint->chunks->next;
+		eprint->chunks->next = chunk->next;
+		chunk->next = eprint->chunks_spare;
+		eprint->chunks_spare = chunk;
+	}
+}
+
+/** unmaps all files mapped by `elastic_print_add_fd()`, no line MUST point
+ * into them anymore */
+static void elastic_print_mappings_release(struct elastic_print *eprint)
+{
+	struct elastic_print_mapping *mapping;
+
+	while (eprint->mappings != NULL) {
+		mapping = eprint->mappings;
+		eprint->mappings = mapping->next;
+
+		munmap(mapping->addr, mapping->length);
+		free(mapping);
+	}
+}
+
+/** drops all lines stored in `eprint` and resets the column widths
+ *
+ * The newest storage-chunk and the line index are kept, so adding the next
+ * lines doesn't need to allocate them again. All other chunks become spare
+ * chunks for the same reason.
+ */
+static void elastic_print_clear(struct elastic_print *eprint)
+{
+	size_t i;
+
+	elastic_print_chunks_recycle(eprint);
+	if (eprint->chunks != NULL) {
+		eprint->chunks->used = 0;
+		eprint->chunks->dead = 0;
+	}
+
+	eprint->lines_count = 0;
+	eprint->lines_borrowed = 0;
+	eprint->cells_count = 0;
+	eprint->cells_dead = 0;
+	eprint->output_length = 0;
+	eprint->output_overflow = 0;
+
+	for (i = 0; i < eprint->columns; i++) {
+		eprint->column_widths[i] = eprint->column_widths_min;
+		eprint->column_cells[i] = 0;
+
+		if (eprint->blocks != NULL) {
+			eprint->blocks[i].count = 0;
+		}
+		if ((eprint->histograms != NULL) &&
+		    (eprint->histograms[i].size > 0)) {
+			memset(eprint->histograms[i].counts, 0,
+			       eprint->histograms[i].size *
+				   sizeof(*eprint->histograms[i].counts));
+		}
+	}
+}
+
+static int elastic_print_stream_flush(struct elastic_print *eprint);
+static int elastic_print_spill_flush(struct elastic_print *eprint);
+static int elastic_print_spill_map(struct elastic_print *eprint);
+
+int elastic_print_create(struct elastic_print *eprint, size_t columns,
+			 size_t column_widths_min)
+{
+	return elastic_print_create_flags(eprint, columns, column_widths_min, 0);
+}
+
+int elastic_print_create_flags(struct elastic_print *eprint, size_t columns,
+			       size_t column_widths_min, unsigned int flags)
+{
+	int rc;
+	size_t i;
+
+	if ((eprint == NULL) || (column_widths_min < 1) ||
+	    ((flags & ~(ELASTIC_PRINT_BLOCKS | ELASTIC_PRINT_DYNAMIC |
+			ELASTIC_PRINT_UPDATE | ELASTIC_PRINT_CONCURRENT)) != 0) ||
+	    ((flags & ELASTIC_PRINT_BLOCKS) && (flags & ELASTIC_PRINT_UPDATE)) ||
+	    ((flags & ELASTIC_PRINT_CONCURRENT) &&
+	     ((flags & (ELASTIC_PRINT_BLOCKS | ELASTIC_PRINT_UPDATE)) ||
+	      ((flags & ELASTIC_PRINT_DYNAMIC) && (columns == 0))))) {
+		rc = EINVAL;
+		goto err;
+	}
+
+	memset(eprint, 0, sizeof(*eprint));
+
+	if (flags & ELASTIC_PRINT_DYNAMIC) {
+		/* the columns are added while lines are */
+		eprint->columns_max = (columns > 0) ? columns : SIZE_MAX;
+		columns = 0;
+	} else {
+		eprint->columns_max = columns;
+	}
+
+	eprint->columns = columns;
+	eprint->columns_size = columns;
+	eprint->lines_count = 0;
+	eprint->column_widths_min = column_widths_min;
+	eprint->stream_fd = -1;
+
+	if (eprint->columns > 0) {
+		eprint->column_widths =
+		    calloc(eprint->columns, sizeof(*eprint->column_widths));
+		if (eprint->column_widths == NULL) {
+			rc = ENOMEM;
+			goto err;
+		}
+		eprint->stats.allocs += 1;
+	} else {
+		eprint->column_widths = NULL;
+	}
+
+	for (i = 0; i < eprint->columns; i++) {
+		eprint->column_widths[i] = eprint->column_widths_min;
+	}
+
+	eprint->column_cells =
+	    calloc(eprint->columns + 1, sizeof(*eprint->column_cells));
+	if (eprint->column_cells == NULL) {
+		rc = ENOMEM;
+		goto err_free_column_widths;
+	}
+	eprint->stats.allocs += 1;
+
+	if (flags & ELASTIC_PRINT_BLOCKS) {
+		rc = elastic_print_blocks_enable(eprint);
+		if (rc != 0) {
+			goto err_free_column_cells;
+		}
+	}
+
+	if (flags & ELASTIC_PRINT_UPDATE) {
+		rc = elastic_print_histograms_enable(eprint);
+		if (rc != 0) {
+			goto err_free_column_cells;
+		}
+	}
+
+	if (flags & ELASTIC_PRINT_CONCURRENT) {
+		rc = elastic_print_concurrent_enable(eprint);
+		if (rc != 0) {
+			goto err_free_column_cells;
+		}
+	}
+
+	rc = 0;
+	goto err;
+err_free_column_cells:
+	free(eprint->column_cells);
+	eprint->column_cells = NULL;
+err_free_column_widths:
+	free(eprint->column_widths);
+	eprint->column_widths = NULL;
+err:
+	return rc;
+}
+
+/** frees everything `eprint` holds, without the statistics dump of
+ * `elastic_print_destory()` */
+static void elastic_print_release(struct elastic_print *eprint)
+{
+	struct elastic_print_chunk *chunk;
+	struct elastic_print_shard *shard;
+	size_t i;
+
+	if (eprint->concurrent != NULL) {
+		while (eprint->concurrent->shards != NULL) {
+			shard = eprint->concurrent->shards;
+			eprint->concurrent->shards = shard->next;
+
+			elastic_print_release(&shard->eprint);
+			free(shard->runs);
+			free(shard);
+		}
+
+		pthread_key_delete(eprint->concurrent->key);
+		free(eprint->concurrent->widths);
+		free(eprint->concurrent);
+		eprint->concurrent = NULL;
+	}
+
+	if (eprint->column_widths != NULL) {
+		free(eprint->column_widths);
+		eprint->column_widths = NULL;
+	}
+
+	if (eprint->column_cells != NULL) {
+		free(eprint->column_cells);
+		eprint->column_cells = NULL;
+	}
+
+	if (eprint->blocks != NULL) {
+		for (i = 0; i < eprint->columns; i++) {
+			free(eprint->blocks[i].widths);
+		}
+
+		free(eprint->blocks);
+		eprint->blocks = NULL;
+	}
+
+	if (eprint->histograms != NULL) {
+		for (i = 0; i < eprint->columns; i++) {
+			free(eprint->histograms[i].counts);
+		}
+
+		free(eprint->histograms);
+		eprint->histograms = NULL;
+	}
+
+	free(eprint->cells_length);
+	free(eprint->cells_width);
+
+	free(eprint->lines_length);
+	free(eprint->lines_cells);
+	free(eprint->lines_cells_first);
+	free(eprint->lines_chunk);
+
+	if (eprint->lines != NULL) {
+		free(eprint->lines);
+		eprint->lines = NULL;
+	}
+
+	while (eprint->chunks != NULL) {
+		chunk = eprint->chunks;
+		eprint->chunks = chunk->next;
+		free(chunk);
+	}
+
+	while (eprint->chunks_spare != NULL) {
+		chunk = eprint->chunks_spare;
+		eprint->chunks_spare = chunk->next;
+		free(chunk);
+	}
+
+	free(eprint->render_block);
+	free(eprint->render_cursor);
+
+	elastic_print_mappings_release(eprint);
+
+	if (eprint->spill != NULL) {
+		if (eprint->spill->map != NULL) {
+			munmap(eprint->spill->map, eprint->spill->mapped);
+		}
+		close(eprint->spill->fd);
+		free(eprint->spill);
+	}
+
+	memset(eprint, 0, sizeof(*eprint));
+}
+
+void elastic_print_destory(struct elastic_print *eprint)
+{
+	const char *dump;
+
+	if (eprint == NULL) {
+		return;
+	}
+
+	dump = getenv(ELASTIC_PRINT_STATS_ENV);
+	if ((dump != NULL) && (dump[0] != '\0')) {
+		elastic_print_stats_fput(eprint, stderr);
+	}
+
+	elastic_print_release(eprint);
+}
+
+/*
+ * Display-width of non-ASCII characters
+ *
+ * Characters outside of ASCII are decoded from UTF-8 and measured like
+ * `wcwidth()` would do in a UTF-8 locale: combining marks and other
+ * zero-width characters take no column, East Asian wide and fullwidth
+ * characters take two, everything else one. Bytes that are not part of a
+ * valid UTF-8 sequence take one column each (terminals usually show a
+ * replacement character for them), C1 control-characters none.
+ *
+ * The tables hold sorted, inclusive ranges of code points, generated from
+ * the Unicode 14.0 data of glibc's `wcwidth()`.
+ */
+
+struct width_range
+{
+	uint32_t	first;
+	uint32_t	last;
+};
+
+static const struct width_range width_zero[] = {
+	{ 0x00300, 0x0036f }, { 0x00483, 0x00489 }, { 0x00591, 0x005bd },
+	{ 0x005bf, 0x005bf }, { 0x005c1, 0x005c2 }, { 0x005c4, 0x005c5 },
+	{ 0x005c7, 0x005c7 }, { 0x00610, 0x0061a }, { 0x0061c, 0x0061c },
+	{ 0x0064b, 0x0065f }, { 0x00670, 0x00670 }, { 0x006d6, 0x006dc },
+	{ 0x006df, 0x006e4 }, { 0x006e7, 0x006e8 }, { 0x006ea, 0x006ed },
+	{ 0x00711, 0x00711 }, { 0x00730, 0x0074a }, { 0x007a6, 0x007b0 },
+	{ 0x007eb, 0x007f3 }, { 0x007fd, 0x007fd }, { 0x00816, 0x00819 },
+	{ 0x0081b, 0x00823 }, { 0x00825, 0x00827 }, { 0x00829, 0x0082d },
+	{ 0x00859, 0x0085b }, { 0x00898, 0x0089f }, { 0x008ca, 0x008e1 },
+	{ 0x008e3, 0x00902 }, { 0x0093a, 0x0093a }, { 0x0093c, 0x0093c },
+	{ 0x00941, 0x00948 }, { 0x0094d, 0x0094d }, { 0x00951, 0x00957 },
+	{ 0x00962, 0x00963 }, { 0x00981, 0x00981 }, { 0x009bc, 0x009bc },
+	{ 0x009c1, 0x009c4 }, { 0x009cd, 0x009cd }, { 0x009e2, 0x009e3 },
+	{ 0x009fe, 0x009fe }, { 0x00a01, 0x00a02 }, { 0x00a3c, 0x00a3c },
+	{ 0x00a41, 0x00a42 }, { 0x00a47, 0x00a48 }, { 0x00a4b, 0x00a4d },
+	{ 0x00a51, 0x00a51 }, { 0x00a70, 0x00a71 }, { 0x00a75, 0x00a75 },
+	{ 0x00a81, 0x00a82 }, { 0x00abc, 0x00abc }, { 0x00ac1, 0x00ac5 },
+	{ 0x00ac7, 0x00ac8 }, { 0x00acd, 0x00acd }, { 0x00ae2, 0x00ae3 },
+	{ 0x00afa, 0x00aff }, { 0x00b01, 0x00b01 }, { 0x00b3c, 0x00b3c },
+	{ 0x00b3f, 0x00b3f }, { 0x00b41, 0x00b44 }, { 0x00b4d, 0x00b4d },
+	{ 0x00b55, 0x00b56 }, { 0x00b62, 0x00b63 }, { 0x00b82, 0x00b82 },
+	{ 0x00bc0, 0x00bc0 }, { 0x00bcd, 0x00bcd }, { 0x00c00, 0x00c00 },
+	{ 0x00c04, 0x00c04 }, { 0x00c3c, 0x00c3c }, { 0x00c3e, 0x00c40 },
+	{ 0x00c46, 0x00c48 }, { 0x00c4a, 0x00c4d }, { 0x00c55, 0x00c56 },
+	{ 0x00c62, 0x00c63 }, { 0x00c81, 0x00c81 }, { 0x00cbc, 0x00cbc },
+	{ 0x00cbf, 0x00cbf }, { 0x00cc6, 0x00cc6 }, { 0x00ccc, 0x00ccd },
+	{ 0x00ce2, 0x00ce3 }, { 0x00d00, 0x00d01 }, { 0x00d3b, 0x00d3c },
+	{ 0x00d41, 0x00d44 }, { 0x00d4d, 0x00d4d }, { 0x00d62, 0x00d63 },
+	{ 0x00d81, 0x00d81 }, { 0x00dca, 0x00dca }, { 0x00dd2, 0x00dd4 },
+	{ 0x00dd6, 0x00dd6 }, { 0x00e31, 0x00e31 }, { 0x00e34, 0x00e3a },
+	{ 0x00e47, 0x00e4e }, { 0x00eb1, 0x00eb1 }, { 0x00eb4, 0x00ebc },
+	{ 0x00ec8, 0x00ecd }, { 0x00f18, 0x00f19 }, { 0x00f35, 0x00f35 },
+	{ 0x00f37, 0x00f37 }, { 0x00f39, 0x00f39 }, { 0x00f71, 0x00f7e },
+	{ 0x00f80, 0x00f84 }, { 0x00f86, 0x00f87 }, { 0x00f8d, 0x00f97 },
+	{ 0x00f99, 0x00fbc }, { 0x00fc6, 0x00fc6 }, { 0x0102d, 0x01030 },
+	{ 0x01032, 0x01037 }, { 0x01039, 0x0103a }, { 0x0103d, 0x0103e },
+	{ 0x01058, 0x01059 }, { 0x0105e, 0x01060 }, { 0x01071, 0x01074 },
+	{ 0x01082, 0x01082 }, { 0x01085, 0x01086 }, { 0x0108d, 0x0108d },
+	{ 0x0109d, 0x0109d }, { 0x01160, 0x011ff }, { 0x0135d, 0x0135f },
+	{ 0x01712, 0x01714 }, { 0x01732, 0x01733 }, { 0x01752, 0x01753 },
+	{ 0x01772, 0x01773 }, { 0x017b4, 0x017b5 }, { 0x017b7, 0x017bd },
+	{ 0x017c6, 0x017c6 }, { 0x017c9, 0x017d3 }, { 0x017dd, 0x017dd },
+	{ 0x0180b, 0x0180f }, { 0x01885, 0x01886 }, { 0x018a9, 0x018a9 },
+	{ 0x01920, 0x01922 }, { 0x01927, 0x01928 }, { 0x01932, 0x01932 },
+	{ 0x01939, 0x0193b }, { 0x01a17, 0x01a18 }, { 0x01a1b, 0x01a1b },
+	{ 0x01a56, 0x01a56 }, { 0x01a58, 0x01a5e }, { 0x01a60, 0x01a60 },
+	{ 0x01a62, 0x01a62 }, { 0x01a65, 0x01a6c }, { 0x01a73, 0x01a7c },
+	{ 0x01a7f, 0x01a7f }, { 0x01ab0, 0x01ace }, { 0x01b00, 0x01b03 },
+	{ 0x01b34, 0x01b34 }, { 0x01b36, 0x01b3a }, { 0x01b3c, 0x01b3c },
+	{ 0x01b42, 0x01b42 }, { 0x01b6b, 0x01b73 }, { 0x01b80, 0x01b81 },
+	{ 0x01ba2, 0x01ba5 }, { 0x01ba8, 0x01ba9 }, { 0x01bab, 0x01bad },
+	{ 0x01be6, 0x01be6 }, { 0x01be8, 0x01be9 }, { 0x01bed, 0x01bed },
+	{ 0x01bef, 0x01bf1 }, { 0x01c2c, 0x01c33 }, { 0x01c36, 0x01c37 },
+	{ 0x01cd0, 0x01cd2 }, { 0x01cd4, 0x01ce0 }, { 0x01ce2, 0x01ce8 },
+	{ 0x01ced, 0x01ced }, { 0x01cf4, 0x01cf4 }, { 0x01cf8, 0x01cf9 },
+	{ 0x01dc0, 0x01dff }, { 0x0200b, 0x0200f }, { 0x0202a, 0x0202e },
+	{ 0x02060, 0x02064 }, { 0x02066, 0x0206f }, { 0x020d0, 0x020f0 },
+	{ 0x02cef, 0x02cf1 }, { 0x02d7f, 0x02d7f }, { 0x02de0, 0x02dff },
+	{ 0x0302a, 0x0302d }, { 0x03099, 0x0309a }, { 0x0a66f, 0x0a672 },
+	{ 0x0a674, 0x0a67d }, { 0x0a69e, 0x0a69f }, { 0x0a6f0, 0x0a6f1 },
+	{ 0x0a802, 0x0a802 }, { 0x0a806, 0x0a806 }, { 0x0a80b, 0x0a80b },
+	{ 0x0a825, 0x0a826 }, { 0x0a82c, 0x0a82c }, { 0x0a8c4, 0x0a8c5 },
+	{ 0x0a8e0, 0x0a8f1 }, { 0x0a8ff, 0x0a8ff }, { 0x0a926, 0x0a92d },
+	{ 0x0a947, 0x0a951 }, { 0x0a980, 0x0a982 }, { 0x0a9b3, 0x0a9b3 },
+	{ 0x0a9b6, 0x0a9b9 }, { 0x0a9bc, 0x0a9bd }, { 0x0a9e5, 0x0a9e5 },
+	{ 0x0aa29, 0x0aa2e }, { 0x0aa31, 0x0aa32 }, { 0x0aa35, 0x0aa36 },
+	{ 0x0aa43, 0x0aa43 }, { 0x0aa4c, 0x0aa4c }, { 0x0aa7c, 0x0aa7c },
+	{ 0x0aab0, 0x0aab0 }, { 0x0aab2, 0x0aab4 }, { 0x0aab7, 0x0aab8 },
+	{ 0x0aabe, 0x0aabf }, { 0x0aac1, 0x0aac1 }, { 0x0aaec, 0x0aaed },
+	{ 0x0aaf6, 0x0aaf6 }, { 0x0abe5, 0x0abe5 }, { 0x0abe8, 0x0abe8 },
+	{ 0x0abed, 0x0abed }, { 0x0d7b0, 0x0d7c6 }, { 0x0d7cb, 0x0d7fb },
+	{ 0x0fb1e, 0x0fb1e }, { 0x0fe00, 0x0fe0f }, { 0x0fe20, 0x0fe2f },
+	{ 0x0feff, 0x0feff }, { 0x0fff9, 0x0fffb }, { 0x101fd, 0x101fd },
+	{ 0x102e0, 0x102e0 }, { 0x10376, 0x1037a }, { 0x10a01, 0x10a03 },
+	{ 0x10a05, 0x10a06 }, { 0x10a0c, 0x10a0f }, { 0x10a38, 0x10a3a },
+	{ 0x10a3f, 0x10a3f }, { 0x10ae5, 0x10ae6 }, { 0x10d24, 0x10d27 },
+	{ 0x10eab, 0x10eac }, { 0x10f46, 0x10f50 }, { 0x10f82, 0x10f85 },
+	{ 0x11001, 0x11001 }, { 0x11038, 0x11046 }, { 0x11070, 0x11070 },
+	{ 0x11073, 0x11074 }, { 0x1107f, 0x11081 }, { 0x110b3, 0x110b6 },
+	{ 0x110b9, 0x110ba }, { 0x110c2, 0x110c2 }, { 0x11100, 0x11102 },
+	{ 0x11127, 0x1112b }, { 0x1112d, 0x11134 }, { 0x11173, 0x11173 },
+	{ 0x11180, 0x11181 }, { 0x111b6, 0x111be }, { 0x111c9, 0x111cc },
+	{ 0x111cf, 0x111cf }, { 0x1122f, 0x11231 }, { 0x11234, 0x11234 },
+	{ 0x11236, 0x11237 }, { 0x1123e, 0x1123e }, { 0x112df, 0x112df },
+	{ 0x112e3, 0x112ea }, { 0x11300, 0x11301 }, { 0x1133b, 0x1133c },
+	{ 0x11340, 0x11340 }, { 0x11366, 0x1136c }, { 0x11370, 0x11374 },
+	{ 0x11438, 0x1143f }, { 0x11442, 0x11444 }, { 0x11446, 0x11446 },
+	{ 0x1145e, 0x1145e }, { 0x114b3, 0x114b8 }, { 0x114ba, 0x114ba },
+	{ 0x114bf, 0x114c0 }, { 0x114c2, 0x114c3 }, { 0x115b2, 0x115b5 },
+	{ 0x115bc, 0x115bd }, { 0x115bf, 0x115c0 }, { 0x115dc, 0x115dd },
+	{ 0x11633, 0x1163a }, { 0x1163d, 0x1163d }, { 0x1163f, 0x11640 },
+	{ 0x116ab, 0x116ab }, { 0x116ad, 0x116ad }, { 0x116b0, 0x116b5 },
+	{ 0x116b7, 0x116b7 }, { 0x1171d, 0x1171f }, { 0x11722, 0x11725 },
+	{ 0x11727, 0x1172b }, { 0x1182f, 0x11837 }, { 0x11839, 0x1183a },
+	{ 0x1193b, 0x1193c }, { 0x1193e, 0x1193e }, { 0x11943, 0x11943 },
+	{ 0x119d4, 0x119d7 }, { 0x119da, 0x119db }, { 0x119e0, 0x119e0 },
+	{ 0x11a01, 0x11a0a }, { 0x11a33, 0x11a38 }, { 0x11a3b, 0x11a3e },
+	{ 0x11a47, 0x11a47 }, { 0x11a51, 0x11a56 }, { 0x11a59, 0x11a5b },
+	{ 0x11a8a, 0x11a96 }, { 0x11a98, 0x11a99 }, { 0x11c30, 0x11c36 },
+	{ 0x11c38, 0x11c3d }, { 0x11c3f, 0x11c3f }, { 0x11c92, 0x11ca7 },
+	{ 0x11caa, 0x11cb0 }, { 0x11cb2, 0x11cb3 }, { 0x11cb5, 0x11cb6 },
+	{ 0x11d31, 0x11d36 }, { 0x11d3a, 0x11d3a }, { 0x11d3c, 0x11d3d },
+	{ 0x11d3f, 0x11d45 }, { 0x11d47, 0x11d47 }, { 0x11d90, 0x11d91 },
+	{ 0x11d95, 0x11d95 }, { 0x11d97, 0x11d97 }, { 0x11ef3, 0x11ef4 },
+	{ 0x13430, 0x13438 }, { 0x16af0, 0x16af4 }, { 0x16b30, 0x16b36 },
+	{ 0x16f4f, 0x16f4f }, { 0x16f8f, 0x16f92 }, { 0x16fe4, 0x16fe4 },
+	{ 0x1bc9d, 0x1bc9e }, { 0x1bca0, 0x1bca3 }, { 0x1cf00, 0x1cf2d },
+	{ 0x1cf30, 0x1cf46 }, { 0x1d167, 0x1d169 }, { 0x1d173, 0x1d182 },
+	{ 0x1d185, 0x1d18b }, { 0x1d1aa, 0x1d1ad }, { 0x1d242, 0x1d244 },
+	{ 0x1da00, 0x1da36 }, { 0x1da3b, 0x1da6c }, { 0x1da75, 0x1da75 },
+	{ 0x1da84, 0x1da84 }, { 0x1da9b, 0x1da9f }, { 0x1daa1, 0x1daaf },
+	{ 0x1e000, 0x1e006 }, { 0x1e008, 0x1e018 }, { 0x1e01b, 0x1e021 },
+	{ 0x1e023, 0x1e024 }, { 0x1e026, 0x1e02a }, { 0x1e130, 0x1e136 },
+	{ 0x1e2ae, 0x1e2ae }, { 0x1e2ec, 0x1e2ef }, { 0x1e8d0, 0x1e8d6 },
+	{ 0x1e944, 0x1e94a }, { 0xe0001, 0xe0001 }, { 0xe0020, 0xe007f },
+	{ 0xe0100, 0xe01ef },
+};
+
+static const struct width_range width_wide[] = {
+	{ 0x01100, 0x0115f }, { 0x0231a, 0x0231b }, { 0x02329, 0x0232a },
+	{ 0x023e9, 0x023ec }, { 0x023f0, 0x023f0 }, { 0x023f3, 0x023f3 },
+	{ 0x025fd, 0x025fe }, { 0x02614, 0x02615 }, { 0x02648, 0x02653 },
+	{ 0x0267f, 0x0267f }, { 0x02693, 0x02693 }, { 0x026a1, 0x026a1 },
+	{ 0x026aa, 0x026ab }, { 0x026bd, 0x026be }, { 0x026c4, 0x026c5 },
+	{ 0x026ce, 0x026ce }, { 0x026d4, 0x026d4 }, { 0x026ea, 0x026ea },
+	{ 0x026f2, 0x026f3 }, { 0x026f5, 0x026f5 }, { 0x026fa, 0x026fa },
+	{ 0x026fd, 0x026fd }, { 0x02705, 0x02705 }, { 0x0270a, 0x0270b },
+	{ 0x02728, 0x02728 }, { 0x0274c, 0x0274c }, { 0x0274e, 0x0274e },
+	{ 0x02753, 0x02755 }, { 0x02757, 0x02757 }, { 0x02795, 0x02797 },
+	{ 0x027b0, 0x027b0 }, { 0x027bf, 0x027bf }, { 0x02b1b, 0x02b1c },
+	{ 0x02b50, 0x02b50 }, { 0x02b55, 0x02b55 }, { 0x02e80, 0x02e99 },
+	{ 0x02e9b, 0x02ef3 }, { 0x02f00, 0x02fd5 }, { 0x02ff0, 0x02ffb },
+	{ 0x03000, 0x03029 }, { 0x0302e, 0x0303e }, { 0x03041, 0x03096 },
+	{ 0x0309b, 0x030ff }, { 0x03105, 0x0312f }, { 0x03131, 0x0318e },
+	{ 0x03190, 0x031e3 }, { 0x031f0, 0x0321e }, { 0x03220, 0x0a48c },
+	{ 0x0a490, 0x0a4c6 }, { 0x0a960, 0x0a97c }, { 0x0ac00, 0x0d7a3 },
+	{ 0x0f900, 0x0fa6d }, { 0x0fa70, 0x0fad9 }, { 0x0fe10, 0x0fe19 },
+	{ 0x0fe30, 0x0fe52 }, { 0x0fe54, 0x0fe66 }, { 0x0fe68, 0x0fe6b },
+	{ 0x0ff01, 0x0ff60 }, { 0x0ffe0, 0x0ffe6 }, { 0x16fe0, 0x16fe3 },
+	{ 0x16ff0, 0x16ff1 }, { 0x17000, 0x187f7 }, { 0x18800, 0x18cd5 },
+	{ 0x18d00, 0x18d08 }, { 0x1aff0, 0x1aff3 }, { 0x1aff5, 0x1affb },
+	{ 0x1affd, 0x1affe }, { 0x1b000, 0x1b122 }, { 0x1b150, 0x1b152 },
+	{ 0x1b164, 0x1b167 }, { 0x1b170, 0x1b2fb }, { 0x1f004, 0x1f004 },
+	{ 0x1f0cf, 0x1f0cf }, { 0x1f18e, 0x1f18e }, { 0x1f191, 0x1f19a },
+	{ 0x1f200, 0x1f202 }, { 0x1f210, 0x1f23b }, { 0x1f240, 0x1f248 },
+	{ 0x1f250, 0x1f251 }, { 0x1f260, 0x1f265 }, { 0x1f300, 0x1f320 },
+	{ 0x1f32d, 0x1f335 }, { 0x1f337, 0x1f37c }, { 0x1f37e, 0x1f393 },
+	{ 0x1f3a0, 0x1f3ca }, { 0x1f3cf, 0x1f3d3 }, { 0x1f3e0, 0x1f3f0 },
+	{ 0x1f3f4, 0x1f3f4 }, { 0x1f3f8, 0x1f43e }, { 0x1f440, 0x1f440 },
+	{ 0x1f442, 0x1f4fc }, { 0x1f4ff, 0x1f53d }, { 0x1f54b, 0x1f54e },
+	{ 0x1f550, 0x1f567 }, { 0x1f57a, 0x1f57a }, { 0x1f595, 0x1f596 },
+	{ 0x1f5a4, 0x1f5a4 }, { 0x1f5fb, 0x1f64f }, { 0x1f680, 0x1f6c5 },
+	{ 0x1f6cc, 0x1f6cc }, { 0x1f6d0, 0x1f6d2 }, { 0x1f6d5, 0x1f6d7 },
+	{ 0x1f6dd, 0x1f6df }, { 0x1f6eb, 0x1f6ec }, { 0x1f6f4, 0x1f6fc },
+	{ 0x1f7e0, 0x1f7eb }, { 0x1f7f0, 0x1f7f0 }, { 0x1f90c, 0x1f93a },
+	{ 0x1f93c, 0x1f945 }, { 0x1f947, 0x1f9ff }, { 0x1fa70, 0x1fa74 },
+	{ 0x1fa78, 0x1fa7c }, { 0x1fa80, 0x1fa86 }, { 0x1fa90, 0x1faac },
+	{ 0x1fab0, 0x1faba }, { 0x1fac0, 0x1fac5 }, { 0x1fad0, 0x1fad9 },
+	{ 0x1fae0, 0x1fae7 }, { 0x1faf0, 0x1faf6 }, { 0x20000, 0x2a6df },
+	{ 0x2a700, 0x2b738 }, { 0x2b740, 0x2b81d }, { 0x2b820, 0x2cea1 },
+	{ 0x2ceb0, 0x2ebe0 }, { 0x2f800, 0x2fa1d }, { 0x30000, 0x3134a },
+};
+
+static inline int width_in_table(uint32_t cp, const struct width_range *table,
+				 size_t size)
+{
+	size_t low = 0, high = size;
+
+	if ((cp < table[0].first) || (cp > table[size - 1].last)) {
+		return 0;
+	}
+
+	while (low < high) {
+		size_t mid = low + ((high - low) / 2);
+
+		if (cp > table[mid].last) {
+			low = mid + 1;
+		} else if (cp < table[mid].first) {
+			high = mid;
+		} else {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/** measures the non-ASCII character at the start of `text`
+ *
+ * \para text		start of the character, `text[0]` is >= 0x80
+ * \para length		number of bytes available in `text`
+ * \para width		receives the display-width of the character
+ *
+ * \returns the number of bytes the character occupies in `text` (>= 1)
+ */
+static size_t width_utf8(const char *text, size_t length, size_t *width)
+{
+	const unsigned char *u = (const unsigned char *) text;
+	unsigned char low = 0x80, high = 0xbf;
+	uint32_t cp;
+	size_t size, i;
+
+	if ((u[0] >= 0xc2) && (u[0] <= 0xdf)) {
+		size = 2;
+		cp = u[0] & 0x1f;
+	} else if ((u[0] >= 0xe0) && (u[0] <= 0xef)) {
+		size = 3;
+		cp = u[0] & 0x0f;
+		/* no overlong forms and no surrogates */
+		if (u[0] == 0xe0) {
+			low = 0xa0;
+		} else if (u[0] == 0xed) {
+			high = 0x9f;
+		}
+	} else if ((u[0] >= 0xf0) && (u[0] <= 0xf4)) {
+		size = 4;
+		cp = u[0] & 0x07;
+		/* no overlong forms and nothing above U+10FFFF */
+		if (u[0] == 0xf0) {
+			low = 0x90;
+		} else if (u[0] == 0xf4) {
+			high = 0x8f;
+		}
+	} else {
+		goto invalid;
+	}
+
+	if (size > length) {
+		goto invalid;
+	}
+
+	for (i = 1; i < size; i++) {
+		if ((u[i] < low) || (u[i] > high)) {
+			goto invalid;
+		}
+		cp = (cp << 6) | (u[i] & 0x3f);
+		low = 0x80;
+		high = 0xbf;
+	}
+
+	if (cp < 0xa0) {
+		/* C1 control-characters */
+		*width = 0;
+	} else if (width_in_table(cp, width_zero,
+				  sizeof(width_zero) / sizeof(*width_zero))) {
+		*width = 0;
+	} else if (width_in_table(cp, width_wide,
+				  sizeof(width_wide) / sizeof(*width_wide))) {
+		*width = 2;
+	} else {
+		*width = 1;
+	}
+
+	return size;
+invalid:
+	*width = 1;
+	return 1;
+}
+
+/*
+ * Byte-classification kernel
+ *
+ * The bytes of a line are looked at in blocks of `SCAN_BLOCK` bytes. For each
+ * block four bit-masks are computed (bit n represents byte n of the block):
+ *
+ *  - `tab`	the byte is a tab, and thus closes a cell
+ *  - `count`	the byte is printable ASCII and counts towards the width of a
+ *		cell
+ *  - `repl`	the byte is a control-character (\v, \f or DEL) that is replaced
+ *		by a space (and thus is also counted)
+ *  - `high`	the byte is not ASCII and starts or continues a UTF-8 sequence
+ *
+ * Blocks of pure ASCII are measured with popcounts on those masks alone.
+ * In a block with non-ASCII bytes this is done up to the first of them, that
+ * character is then measured with `width_utf8()` and the next block starts
+ * right behind it.
+ *
+ * For ASCII the classification follows `isprint()`/`isspace()` in the "C"
+ * locale. With SSE2 or AVX2 the masks are computed with vector-compares,
+ * otherwise (and for the remainder of a line that doesn't fill a whole
+ * block) byte by byte.
+ */
+
+#if defined(__AVX2__)
+#define SCAN_BLOCK	32
+#elif defined(__SSE2__)
+#define SCAN_BLOCK	16
+#else
+#define SCAN_BLOCK	64
+#endif
+
+struct scan_masks
+{
+	uint64_t	tab;
+	uint64_t	count;
+	uint64_t	repl;
+	uint64_t	high;
+};
+
+static inline void scan_masks_scalar(const char *text, size_t length,
+				     struct scan_masks *masks)
+{
+	size_t i;
+	unsigned char c;
+
+	masks->tab = masks->count = masks->repl = masks->high = 0;
+
+	for (i = 0; i < length; i++) {
+		c = (unsigned char) text[i];
+
+		if (c == '\t') {
+			masks->tab |= (uint64_t) 1 << i;
+		} else if ((c >= 0x20) && (c < 0x7f)) {
+			masks->count |= (uint64_t) 1 << i;
+		} else if ((c == '\v') || (c == '\f') || (c == 0x7f)) {
+			masks->repl |= (uint64_t) 1 << i;
+		} else if (c >= 0x80) {
+			masks->high |= (uint64_t) 1 << i;
+		}
+	}
+}
+
+static inline void scan_masks_block(const char *text, struct scan_masks *masks)
+{
+#if defined(__AVX2__)
+	__m256i v = _mm256_loadu_si256((const __m256i *) text);
+	__m256i print = _mm256_and_si256(
+	    _mm256_cmpgt_epi8(v, _mm256_set1_epi8(0x1f)),
+	    _mm256_cmpgt_epi8(_mm256_set1_epi8(0x7f), v));
+	__m256i repl = _mm256_or_si256(
+	    _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\v')),
+			    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\f'))),
+	    _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f)));
+
+	masks->tab = (uint32_t) _mm256_movemask_epi8(
+	    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+	masks->count = (uint32_t) _mm256_movemask_epi8(print);
+	masks->repl = (uint32_t) _mm256_movemask_epi8(repl);
+	masks->high = (uint32_t) _mm256_movemask_epi8(v);
+#elif defined(__SSE2__)
+	__m128i v = _mm_loadu_si128((const __m128i *) text);
+	__m128i print = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f)),
+				      _mm_cmplt_epi8(v, _mm_set1_epi8(0x7f)));
+	__m128i repl = _mm_or_si128(
+	    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\v')),
+			 _mm_cmpeq_epi8(v, _mm_set1_epi8('\f'))),
+	    _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)));
+
+	masks->tab = (uint16_t) _mm_movemask_epi8(
+	    _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+	masks->count = (uint16_t) _mm_movemask_epi8(print);
+	masks->repl = (uint16_t) _mm_movemask_epi8(repl);
+	masks->high = (uint16_t) _mm_movemask_epi8(v);
+#else
+	scan_masks_scalar(text, SCAN_BLOCK, masks);
+#endif
+}
+
+/** classifies all bytes of one line in a single pass
+ *
+ * \para text		the line, MUST not contain line-breaks
+ * \para length		length of `text`
+ * \para max_tabs	number of tabs after which no more cells are measured
+ * \para widths		array of at least `max_tabs` + 1 elements
+ * \para lengths	array of at least `max_tabs` + 1 elements
+ *
+ * \para replace	where control-characters that need it are replaced by
+ *			spaces, at the same offsets as in `text` (can be
+ *			`text` itself); or NULL to leave all of them as they
+ *			are
+ *
+ * \returns the number n of tabs found, but at most `max_tabs`
+ * \returns SIZE_MAX	if `replace` is NULL and `text` contains a
+ *			control-character that would have to be replaced
+ *
+ * The
+ * width of the cell finished by the i-th tab is stored in `widths[i]` and its
+ * length (without the tab) in `lengths[i]` for i < n. If n < `max_tabs` the
+ * width and length of the text behind the last tab are stored at index n.
+ */
+static size_t elastic_print_scan(const char *text, size_t length,
+				 size_t max_tabs, size_t *widths,
+				 size_t *lengths, char *replace)
+{
+	struct scan_masks masks;
+	uint64_t counted, tabs, below, ascii;
+	size_t pos, block, base, bit, tabs_found = 0, width = 0, start = 0;
+	size_t char_width;
+
+	for (pos = 0; pos < length; pos += block) {
+		block = length - pos;
+		if (block >= SCAN_BLOCK) {
+			block = SCAN_BLOCK;
+			scan_masks_block(&text[pos], &masks);
+		} else {
+			scan_masks_scalar(&text[pos], block, &masks);
+		}
+
+		if (masks.high != 0) {
+			/* only look at the ASCII in front of the first
+			 * non-ASCII byte, see below */
+			block = (size_t) __builtin_ctzll(masks.high);
+			ascii = ((uint64_t) 1 << block) - 1;
+
+			masks.tab &= ascii;
+			masks.count &= ascii;
+			masks.repl &= ascii;
+		}
+
+		if ((masks.repl != 0) && (replace == NULL)) {
+			return SIZE_MAX;
+		}
+		for (tabs = masks.repl; tabs != 0; tabs &= tabs - 1) {
+			replace[pos + (size_t) __builtin_ctzll(tabs)] = ' ';
+		}
+
+		if (tabs_found >= max_tabs) {
+			goto next_high;
+		}
+
+		counted = masks.count | masks.repl;
+		base = 0;
+
+		for (tabs = masks.tab; tabs != 0; tabs &= tabs - 1) {
+			bit = (size_t) __builtin_ctzll(tabs);
+			below = (((uint64_t) 1 << bit) - 1) &
+				~(((uint64_t) 1 << base) - 1);
+
+			widths[tabs_found] =
+			    width + (size_t) __builtin_popcountll(counted & below);
+			lengths[tabs_found] = pos + bit - start;
+			width = 0;
+			base = bit + 1;
+			start = pos + base;
+
+			tabs_found += 1;
+			if (tabs_found >= max_tabs) {
+				break;
+			}
+		}
+
+		if (tabs_found < max_tabs) {
+			width += (size_t) __builtin_popcountll(counted >> base);
+		}
+
+next_high:
+		if (masks.high != 0) {
+			block += width_utf8(&text[pos + block],
+					    length - (pos + block), &char_width);
+			width += char_width;
+		}
+	}
+
+	if (tabs_found < max_tabs) {
+		widths[tabs_found] = width;
+		lengths[tabs_found] = length - start;
+	}
+
+	return tabs_found;
+}
+
+/** accounts for `size` more bytes of stored lines in spill mode, and
+ * spills them once they exceed the budget
+ *
+ * \returns `elastic_print_spill_flush()`
+ */
+static inline int elastic_print_spill_add(struct elastic_print *eprint,
+					  size_t size)
+{
+	eprint->spill->pending += size;
+	if (eprint->spill->pending < eprint->spill->budget) {
+		return 0;
+	}
+
+	return elastic_print_spill_flush(eprint);
+}
+
+/** stores one single line (without any line-break) in `eprint`
+ *
+ * \para eprint		current elastictab instance
+ * \para text		the line, MUST not contain '\0', '\n' or '\r'
+ * \para length		length of `text`
+ * \para terminated	whether the line was finished by a line-break in the
+ *			input; such lines don't get a closing elastic tab
+ * \para borrowed	whether only a reference to `text` is stored, see
+ *			`elastic_print_add_borrowed()`
+ *
+ * \returns ENOMEM	if not enough memory could be allocated
+ * \returns errno	as reported by `writev()` in streaming or spill mode
+ * \returns 0		in case everything went OK
+ *
+ * In streaming mode a line without any elastic cell closes every column
+ * block. All lines up to it are written out, once enough output was
+ * collected. In spill mode the stored lines are written to the spill-file,
+ * once they exceed the budget.
+ */
+static int elastic_print_add_single(struct elastic_print *eprint,
+				    const char *text, size_t length,
+				    int terminated, int borrowed)
+{
+	char *stored;
+	size_t line, tabs = SIZE_MAX, i, *cells_width, *cells_length;
+	int rc;
+
+	if (length > (SIZE_MAX - 1)) {
+		return EINVAL;
+	}
+
+	rc = elastic_print_lines_reserve(eprint, 1);
+	if (rc != 0) {
+		return rc;
+	}
+
+	/* a line can't have more tabs than characters, and one more cell is
+	 * needed for the text behind the last tab */
+	rc = elastic_print_cells_reserve(eprint,
+					 ((length < eprint->columns_max) ?
+					      length :
+					      eprint->columns_max) + 1);
+	if (rc != 0) {
+		return rc;
+	}
+
+	/* the cells are measured right into the cell index */
+	cells_width = &(eprint->cells_width[eprint->cells_count]);
+	cells_length = &(eprint->cells_length[eprint->cells_count]);
+
+	if (borrowed) {
+		tabs = elastic_print_scan(text, length, eprint->columns_max,
+					  cells_width, cells_length, NULL);
+	}
+
+	line = eprint->lines_count;
+
+	if (tabs == SIZE_MAX) {
+		/* a borrowed line is stored after all, if it has characters
+		 * that are replaced in the output */
+		borrowed = 0;
+
+		/* room for the newline */
+		stored = elastic_print_chunk_alloc(eprint,
+						   (length + 1) * sizeof(*stored));
+		if (stored == NULL) {
+			return ENOMEM;
+		}
+
+		/* `text` can lie in the space `stored` was just carved from,
+		 * see `elastic_print_add_printf()`; `stored` is never behind
+		 * it then */
+		memmove(stored, text, length);
+		stored[length] = '\n';
+
+		tabs = elastic_print_scan(stored, length, eprint->columns_max,
+					  cells_width, cells_length, stored);
+		eprint->lines[line] = stored;
+		if (eprint->lines_chunk != NULL) {
+			eprint->lines_chunk[line] =
+			    elastic_print_chunk_owner(eprint, stored);
+		}
+	} else {
+		eprint->lines[line] = text;
+		if (eprint->lines_chunk != NULL) {
+			eprint->lines_chunk[line] = NULL;
+		}
+	}
+
+	eprint->lines_length[line] = length;
+	eprint->lines_cells_first[line] = eprint->cells_count;
+	eprint->lines_count += 1;
+
+	/* room for a closing elastic tab in case the line gets one */
+	rc = elastic_print_columns_reserve(
+	    eprint, ((tabs < eprint->columns_max) && (eprint->blocks == NULL)) ?
+			tabs + 1 :
+			tabs);
+	if (rc != 0) {
+		goto err_drop_line;
+	}
+
+	eprint->lines_cells[line] = tabs;
+
+#define __count_line()                                                         \
+	{                                                                      \
+		eprint->stats.lines_added += 1;                                \
+		if (borrowed) {                                                \
+			eprint->lines_borrowed += 1;                           \
+			eprint->stats.bytes_borrowed += length;                \
+		} else {                                                       \
+			eprint->stats.bytes_stored += length + 1;              \
+		}                                                              \
+	}
+
+	if (eprint->blocks != NULL) {
+		/* with column blocks only cells finished by a real tab are
+		 * elastic */
+		rc = elastic_print_blocks_add(eprint, tabs);
+		if (rc != 0) {
+			goto err_drop_line;
+		}
+
+		eprint->cells_count += tabs;
+		elastic_print_output_grow(eprint, 1, length + 1);
+		__count_line();
+
+		if (eprint->spill != NULL) {
+			return elastic_print_spill_add(eprint, length + 1);
+		}
+
+		if ((eprint->stream_fd >= 0) && (tabs == 0) &&
+		    (eprint->output_length >= ELASTIC_PRINT_STREAM_FLUSH)) {
+			/* all blocks are closed by this line */
+			return elastic_print_stream_flush(eprint);
+		}
+
+		return 0;
+	}
+
+	if (eprint->histograms != NULL) {
+		/* the histograms have to be big enough, before anything is
+		 * accounted for */
+		for (i = 0; (rc == 0) && (i < tabs); i++) {
+			rc = elastic_print_histogram_reserve(eprint, i,
+							     cells_width[i] + 1);
+		}
+		if ((rc == 0) && (tabs < eprint->columns_max)) {
+			rc = elastic_print_histogram_reserve(
+			    eprint, tabs, cells_width[tabs] + (terminated ? 0 : 1));
+		}
+		if (rc != 0) {
+			goto err_drop_line;
+		}
+	}
+
+#define __set_max_cw(i, len)                                                   \
+	{                                                                      \
+		if ((i) < eprint->columns) {                                   \
+			if (eprint->histograms != NULL) {                      \
+				eprint->histograms[(i)].counts[(len)] += 1;    \
+			}                                                      \
+			if (eprint->column_widths[(i)] < (len)) {              \
+				elastic_print_output_grow(                     \
+				    eprint, eprint->column_cells[(i)],         \
+				    (len) - eprint->column_widths[(i)]);       \
+				eprint->column_widths[(i)] = (len);            \
+			}                                                      \
+		}                                                              \
+	}
+/* a elastic cell is printed with its elastic width instead of its text-width
+ * and the finishing tab (already accounted for in the line-length) */
+#define __add_cell(i, width)                                                   \
+	{                                                                      \
+		eprint->column_cells[(i)] += 1;                                \
+		elastic_print_output_grow(                                     \
+		    eprint, 1, eprint->column_widths[(i)] - ((width) + 1));    \
+	}
+
+	/* the printed line has the same characters as the stored one, but
+	 * with a finishing newline */
+	elastic_print_output_grow(eprint, 1, length + 1);
+
+	for (i = 0; i < tabs; i++) {
+		__set_max_cw(i, cells_width[i] + 1);
+		__add_cell(i, cells_width[i]);
+	}
+
+	if (tabs < eprint->columns_max) {
+		if (terminated) {
+			__set_max_cw(tabs, cells_width[tabs]);
+		} else {
+			/* still in a valid column, the text behind the last
+			 * tab becomes a elastic cell, as if the line had a
+			 * closing tab */
+			eprint->lines_cells[line] += 1;
+			elastic_print_output_grow(eprint, 1, 1);
+
+			__set_max_cw(tabs, cells_width[tabs] + 1);
+			__add_cell(tabs, cells_width[tabs]);
+		}
+	}
+
+#undef __add_cell
+#undef __set_max_cw
+
+	eprint->cells_count += eprint->lines_cells[line];
+	__count_line();
+
+	if (eprint->spill != NULL) {
+		return elastic_print_spill_add(eprint, length + 1);
+	}
+
+	return 0;
+err_drop_line:
+	eprint->lines_count -= 1;
+	return rc;
+}
+
+#undef __count_line
+
+/** adds all lines in `[cur, end)`, which MUST not contain any '\0'
+ *
+ * \para borrowed	see `elastic_print_add_single()`
+ *
+ * \returns `elastic_print_add_single()`
+ */
+static int elastic_print_add_text(struct elastic_print *eprint,
+				  const char *cur, const char *end,
+				  int borrowed)
+{
+	int rc;
+	const char *next_nl, *next_cr, *brk, *next;
+
+	eprint->stats.bytes_added += (size_t)(end - cur);
+
+	next_nl = memchr(cur, '\n', (size_t)(end - cur));
+	next_cr = memchr(cur, '\r', (size_t)(end - cur));
+
+	while (cur < end) {
+		/* the positions of the next breaks are cached, so every byte is
+		 * only searched once per break-character */
+		if ((next_nl != NULL) && (next_nl < cur)) {
+			next_nl = memchr(cur, '\n', (size_t)(end - cur));
+		}
+		if ((next_cr != NULL) && (next_cr < cur)) {
+			next_cr = memchr(cur, '\r', (size_t)(end - cur));
+		}
+
+		if ((next_nl == NULL) ||
+		    ((next_cr != NULL) && (next_cr < next_nl))) {
+			brk = next_cr;
+		} else {
+			brk = next_nl;
+		}
+
+		if (brk == NULL) {
+			return elastic_print_add_single(eprint, cur,
+							(size_t)(end - cur), 0,
+							borrowed);
+		}
+
+		/* "\r\n" and "\n\r" are one single line-break; this is looked
+		 * at first, as the line can be stored over its line-break */
+		next = brk + 1;
+		if ((next < end) && (*next == ((*brk == '\n') ? '\r' : '\n'))) {
+			next++;
+		}
+
+		rc = elastic_print_add_single(eprint, cur, (size_t)(brk - cur),
+					      1, borrowed);
+		if (rc != 0) {
+			return rc;
+		}
+
+		cur = next;
+	}
+
+	return 0;
+}
+
+/** sets up `part` as an empty instance that uses the same settings as
+ * `eprint`, for lines that are merged into `eprint` later */
+static int elastic_print_part_init(const struct elastic_print *eprint,
+				   struct elastic_print *part)
+{
+	int rc;
+
+	memset(part, 0, sizeof(*part));
+
+	part->columns_max = eprint->columns_max;
+	part->column_widths_min = eprint->column_widths_min;
+	part->stream_fd = -1;
+
+	rc = elastic_print_columns_reserve(part, eprint->columns);
+	if (rc != 0) {
+		return rc;
+	}
+
+	if (eprint->blocks != NULL) {
+		rc = elastic_print_blocks_enable(part);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+/** returns the shard of the calling thread in concurrent mode, with room
+ * for one more run of lines that already took its sequence number
+ *
+ * The shard is created by the first call of each thread.
+ *
+ * \returns ENOMEM	in case the shard could not be allocated or grown
+ * \returns errno	as reported by `pthread_setspecific()`
+ * \returns 0		if everything went OK
+ */
+static int elastic_print_shard_get(struct elastic_print *eprint,
+				   struct elastic_print_shard **shard)
+{
+	struct elastic_print_concurrent *concurrent = eprint->concurrent;
+	struct elastic_print_shard *created;
+	struct elastic_print_run *runs;
+	size_t size;
+	int rc;
+
+	*shard = pthread_getspecific(concurrent->key);
+	if (*shard == NULL) {
+		created = calloc(1, sizeof(*created));
+		if (created == NULL) {
+			return ENOMEM;
+		}
+
+		rc = elastic_print_part_init(eprint, &created->eprint);
+		if (rc == 0) {
+			rc = pthread_setspecific(concurrent->key, created);
+		}
+		if (rc != 0) {
+			elastic_print_release(&created->eprint);
+			free(created);
+			return rc;
+		}
+		created->eprint.stats.allocs += 1;
+
+		/* other threads can push their shards at the same time */
+		created->next =
+		    __atomic_load_n(&concurrent->shards, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(
+		    &concurrent->shards, &created->next, created, 1,
+		    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+			/* `created->next` was updated, try again */
+		}
+
+		*shard = created;
+	}
+
+	if ((*shard)->runs_count == (*shard)->runs_size) {
+		size = ((*shard)->runs_size > 0) ? (*shard)->runs_size :
+						   ELASTIC_PRINT_LINES_START;
+		if (size > ((SIZE_MAX / sizeof(*runs)) / 2)) {
+			return ENOMEM;
+		}
+		size *= 2;
+
+		runs = realloc((*shard)->runs, size * sizeof(*runs));
+		if (runs == NULL) {
+			return ENOMEM;
+		}
+		(*shard)->eprint.stats.reallocs += 1;
+		(*shard)->runs = runs;
+		(*shard)->runs_size = size;
+	}
+
+	(*shard)->runs[(*shard)->runs_count].seq =
+	    __atomic_fetch_add(&concurrent->seq, 1, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+/** finishes the run of lines `shard` got since it had `lines` lines, and
+ * publishes the widths of its columns */
+static void elastic_print_shard_commit(struct elastic_print *eprint,
+				       struct elastic_print_shard *shard,
+				       size_t lines)
+{
+	struct elastic_print_concurrent *concurrent = eprint->concurrent;
+	size_t column, width, seen;
+
+	if (shard->eprint.lines_count == lines) {
+		/* nothing added, the sequence number is just skipped */
+		return;
+	}
+
+	shard->runs[shard->runs_count].end = shard->eprint.lines_count;
+	shard->runs_count += 1;
+
+	for (column = 0; column < shard->eprint.columns; column++) {
+		width = shard->eprint.column_widths[column];
+		seen = __atomic_load_n(&concurrent->widths[column],
+				       __ATOMIC_RELAXED);
+
+		/* a failed exchange updates `seen` */
+		while ((seen < width) &&
+		       !__atomic_compare_exchange_n(&concurrent->widths[column],
+						    &seen, width, 1,
+						    __ATOMIC_RELAXED,
+						    __ATOMIC_RELAXED)) {
+		}
+	}
+}
+
+/** adds the text in `[text, text + length)` (up to the first '\0') to
+ * `eprint`, or to the shard of the calling thread in concurrent mode
+ *
+ * \para borrowed	see `elastic_print_add_single()`
+ */
+static int elastic_print_add_input(struct elastic_print *eprint,
+				   const char *text, size_t length,
+				   int borrowed)
+{
+	struct elastic_print *target = eprint;
+	struct elastic_print_shard *shard = NULL;
+	const char *end;
+	size_t lines = 0;
+	uint64_t start;
+	int rc;
+
+	if (eprint->concurrent != NULL) {
+		rc = elastic_print_shard_get(eprint, &shard);
+		if (rc != 0) {
+			return rc;
+		}
+
+		target = &(shard->eprint);
+		lines = target->lines_count;
+	}
+
+	/* the spill-file only takes stored lines */
+	if (eprint->spill != NULL) {
+		borrowed = 0;
+	}
+
+	start = elastic_print_clock();
+
+	/* everything behind a 0-terminator is ignored */
+	end = memchr(text, '\0', length);
+	if (end == NULL) {
+		end = text + length;
+	}
+
+	rc = elastic_print_add_text(target, text, end, borrowed);
+
+	target->stats.add_nsec += elastic_print_clock() - start;
+
+	if (shard != NULL) {
+		elastic_print_shard_commit(eprint, shard, lines);
+	}
+	return rc;
+}
+
+int elastic_print_add_line(struct elastic_print *eprint, char *line,
+			   size_t length)
+{
+	if (eprint == NULL) {
+		return EINVAL;
+	}
+	if ((line == NULL) || (length == 0) || (line[0] == '\0')) {
+		return 0;
+	}
+
+	return elastic_print_add_input(eprint, line, length, 0);
+}
+
+int elastic_print_add_borrowed(struct elastic_print *eprint, const char *text,
+			       size_t length)
+{
+	if (eprint == NULL) {
+		return EINVAL;
+	}
+	if ((text == NULL) || (length == 0) || (text[0] == '\0')) {
+		return 0;
+	}
+
+	return elastic_print_add_input(eprint, text, length, 1);
+}
+
+int elastic_print_add_string(struct elastic_print *eprint, char *str)
+{
+	if (str == NULL) {
+		return 0;
+	}
+
+	return elastic_print_add_line(eprint, str, strlen(str) + 1);
+}
+
+/** `elastic_print_add_printf()` with a `va_list`, always adds to `eprint`
+ * itself */
+static int elastic_print_add_vprintf(struct elastic_print *eprint,
+				     const char *fmt, va_list arguments)
+{
+	int rc = 0;
+	char *buffer;
+	const char *end;
+	size_t buffer_len;
+	int written;
+	uint64_t start;
+
+	va_list retry;
+
+	start = elastic_print_clock();
+
+	/* the text is formatted right into the free space of the line storage,
+	 * from where it is stored without another allocation */
+	buffer = elastic_print_chunk_reserve(eprint, 1);
+	if (buffer == NULL) {
+		rc = ENOMEM;
+		goto err;
+	}
+	buffer_len = eprint->chunks->size - eprint->chunks->used;
+
+	va_copy(retry, arguments);
+
+	written = vsnprintf(buffer, buffer_len, fmt, arguments);
+	if (written < 0) {
+		rc = EFAULT;
+		goto err_va_end;
+	} else if ((size_t) written >= buffer_len) {
+		/* didn't fit, try again with a chunk that is big enough */
+		buffer_len = (size_t) written + 1;
+
+		buffer = elastic_print_chunk_reserve(eprint, buffer_len);
+		if (buffer == NULL) {
+			rc = ENOMEM;
+			goto err_va_end;
+		}
+
+		written = vsnprintf(buffer, buffer_len, fmt, retry);
+		if ((written < 0) || ((size_t) written >= buffer_len)) {
+			rc = EFAULT;
+			goto err_va_end;
+		}
+	}
+
+	/* everything behind a 0-terminator is ignored */
+	end = memchr(buffer, '\0', (size_t) written);
+	if (end == NULL) {
+		end = buffer + written;
+	}
+
+	rc = elastic_print_add_text(eprint, buffer, end, 0);
+	if (rc != 0) {
+		goto err_va_end;
+	}
+
+/* out: */
+	rc = 0;
+err_va_end:
+	va_end(retry);
+	eprint->stats.add_nsec += elastic_print_clock() - start;
+err:
+	return rc;
+}
+
+int elastic_print_add_printf(struct elastic_print *eprint, const char *fmt, ...)
+{
+	int rc;
+	struct elastic_print_shard *shard = NULL;
+	size_t lines;
+
+	va_list arguments;
+
+	if ((eprint == NULL) || (fmt == NULL)) {
+		return EINVAL;
+	}
+
+	va_start(arguments, fmt);
+
+	if (eprint->concurrent != NULL) {
+		rc = elastic_print_shard_get(eprint, &shard);
+		if (rc == 0) {
+			lines = shard->eprint.lines_count;
+			rc = elastic_print_add_vprintf(&shard->eprint, fmt,
+						       arguments);
+			elastic_print_shard_commit(eprint, shard, lines);
+		}
+	} else {
+		rc = elastic_print_add_vprintf(eprint, fmt, arguments);
+	}
+
+	va_end(arguments);
+	return rc;
+}
+
+/** takes everything `line` accounts for in the column widths and the
+ * output length of `eprint` out again, but leaves it in the index */
+static void elastic_print_line_unaccount(struct elastic_print *eprint,
+					 size_t line)
+{
+	size_t column, cell, pos, width, length;
+	size_t cells = eprint->lines_cells[line];
+
+	pos = 0;
+	cell = eprint->lines_cells_first[line];
+	for (column = 0; column < cells; column++, cell++) {
+		eprint->output_length -= eprint->cells_length[cell] +
+					 eprint->column_widths[column] -
+					 eprint->cells_width[cell];
+		eprint->column_cells[column] -= 1;
+		pos += eprint->cells_length[cell] + 1;
+	}
+
+	/* the closing elastic tab of a line is not stored, so its cells can
+	 * span more than the line itself */
+	if (pos <= eprint->lines_length[line]) {
+		eprint->output_length -= eprint->lines_length[line] - pos;
+
+		if (cells < eprint->columns_max) {
+			/* a line-break finished the line, the text behind its
+			 * last tab widens the next column without padding */
+			elastic_print_scan(&(eprint->lines[line][pos]),
+					   eprint->lines_length[line] - pos, 1,
+					   &width, &length, NULL);
+			elastic_print_histogram_remove(eprint, cells, width);
+		}
+	}
+	eprint->output_length -= 1;
+
+	cell = eprint->lines_cells_first[line];
+	for (column = 0; column < cells; column++, cell++) {
+		elastic_print_histogram_remove(eprint, column,
+					       eprint->cells_width[cell] + 1);
+	}
+}
+
+/** moves the index entry of line `from` to `to` */
+static void elastic_print_line_move(struct elastic_print *eprint, size_t to,
+				    size_t from)
+{
+	eprint->lines[to] = eprint->lines[from];
+	eprint->lines_length[to] = eprint->lines_length[from];
+	eprint->lines_cells[to] = eprint->lines_cells[from];
+	eprint->lines_cells_first[to] = eprint->lines_cells_first[from];
+	if (eprint->lines_chunk != NULL) {
+		eprint->lines_chunk[to] = eprint->lines_chunk[from];
+	}
+}
+
+/** copies the lines still stored in `chunk` into other chunks, and makes it
+ * a spare chunk
+ *
+ * The newest chunk is only emptied, if there are no lines left in it. If
+ * there is not enough memory to copy all lines, the chunk is kept with
+ * those lines that are left.
+ */
+static void elastic_print_chunk_compact(struct elastic_print *eprint,
+					struct elastic_print_chunk *chunk)
+{
+	struct elastic_print_chunk *fresh, **link;
+	size_t line, size;
+	char *stored;
+
+	if (chunk->dead == chunk->used) {
+		if (chunk == eprint->chunks) {
+			/* nothing left in it, it can be filled again */
+			chunk->used = 0;
+			chunk->dead = 0;
+			return;
+		}
+	} else {
+		if (chunk == eprint->chunks) {
+			/* the lines must not be copied into the same chunk */
+			fresh = elastic_print_chunk_new(eprint,
+							ELASTIC_PRINT_CHUNK_SIZE);
+			if (fresh == NULL) {
+				return;
+			}
+			fresh->next = chunk;
+			eprint->chunks = fresh;
+		}
+
+		for (line = 0; line < eprint->lines_count; line++) {
+			if (eprint->lines_chunk[line] != chunk) {
+				continue;
+			}
+
+			size = eprint->lines_length[line] + 1;
+			stored = elastic_print_chunk_alloc(eprint, size);
+			if (stored == NULL) {
+				return;
+			}
+
+			memcpy(stored, eprint->lines[line], size);
+			eprint->lines[line] = stored;
+			eprint->lines_chunk[line] =
+			    elastic_print_chunk_owner(eprint, stored);
+			chunk->dead += size;
+		}
+	}
+
+	/* only done once half a chunk is no longer used, so walking the list
+	 * costs less than the copies above */
+	for (link = &(eprint->chunks); *link != chunk;
+	     link = &((*link)->next)) {
+	}
+
+	*link = chunk->next;
+	chunk->next = eprint->chunks_spare;
+	eprint->chunks_spare = chunk;
+}
+
+/** gives `size` bytes of the line storage at `text` in `chunk` back, that
+ * are no longer used by any line
+ *
+ * Bytes at the end of the handed out space of a chunk are handed out again
+ * right away. Once more than half of a chunk is no longer used, the lines
+ * left in it are moved out, and a chunk without any lines left becomes a
+ * spare chunk, see `elastic_print_chunk_compact()`.
+ */
+static void elastic_print_chunk_release(struct elastic_print *eprint,
+					struct elastic_print_chunk *chunk,
+					const char *text, size_t size)
+{
+	if (size == 0) {
+		return;
+	}
+
+	if (text + size == &(chunk->data[chunk->used])) {
+		chunk->used -= size;
+	} else {
+		chunk->dead += size;
+	}
+
+	if ((chunk->dead == chunk->used) ||
+	    (chunk->dead > (chunk->used - chunk->dead))) {
+		elastic_print_chunk_compact(eprint, chunk);
+	}
+}
+
+/** copies the cells of all lines into new arrays, without the cells of
+ * lines that were replaced or removed
+ *
+ * If there is not enough memory for the new arrays, the old ones are kept.
+ */
+static void elastic_print_cells_compact(struct elastic_print *eprint)
+{
+	size_t *cells_length, *cells_width;
+	size_t line, count = 0;
+
+	cells_length = malloc(eprint->cells_size * sizeof(*cells_length));
+	cells_width = malloc(eprint->cells_size * sizeof(*cells_width));
+	if ((cells_length == NULL) || (cells_width == NULL)) {
+		free(cells_length);
+		free(cells_width);
+		return;
+	}
+	eprint->stats.allocs += 2;
+
+	for (line = 0; line < eprint->lines_count; line++) {
+		memcpy(&cells_length[count],
+		       &(eprint->cells_length[eprint->lines_cells_first[line]]),
+		       eprint->lines_cells[line] * sizeof(*cells_length));
+		memcpy(&cells_width[count],
+		       &(eprint->cells_width[eprint->lines_cells_first[line]]),
+		       eprint->lines_cells[line] * sizeof(*cells_width));
+
+		eprint->lines_cells_first[line] = count;
+		count += eprint->lines_cells[line];
+	}
+	assert(count == (eprint->cells_count - eprint->cells_dead));
+
+	free(eprint->cells_length);
+	free(eprint->cells_width);
+	eprint->cells_length = cells_length;
+	eprint->cells_width = cells_width;
+
+	eprint->cells_count = count;
+	eprint->cells_dead = 0;
+}
+
+/** gives the cells `[first, first + count)` back, that are no longer used
+ * by any line */
+static void elastic_print_cells_release(struct elastic_print *eprint,
+					size_t first, size_t count)
+{
+	if ((first + count) == eprint->cells_count) {
+		eprint->cells_count -= count;
+	} else {
+		eprint->cells_dead += count;
+	}
+
+	if (eprint->cells_dead > (eprint->cells_count - eprint->cells_dead)) {
+		elastic_print_cells_compact(eprint);
+	}
+}
+
+/** gives the storage of the text of a line back, that was removed or
+ * replaced
+ *
+ * \para chunk		the entry of the line in `lines_chunk`
+ * \para text, length	the text of the line
+ */
+static void elastic_print_text_release(struct elastic_print *eprint,
+				       struct elastic_print_chunk *chunk,
+				       const char *text, size_t length)
+{
+	if (chunk == NULL) {
+		/* the memory of a borrowed line is not ours */
+		eprint->lines_borrowed -= 1;
+		return;
+	}
+
+	elastic_print_chunk_release(eprint, chunk, text, length + 1);
+}
+
+int elastic_print_update_line(struct elastic_print *eprint, size_t line,
+			      const char *text, size_t length)
+{
+	int rc;
+	const char *end, *old_text;
+	struct elastic_print_chunk *old_chunk, *chunk;
+	size_t old_length, old_first, old_cells, cells;
+	int terminated = 0;
+	uint64_t start;
+
+	if ((eprint == NULL) || (eprint->histograms == NULL) ||
+	    (line >= eprint->lines_count) || ((text == NULL) && (length > 0))) {
+		return EINVAL;
+	}
+
+	end = (length > 0) ? memchr(text, '\0', length) : NULL;
+	if (end != NULL) {
+		length = (size_t)(end - text);
+	}
+
+	/* a single line-break can finish the line */
+	if ((length > 0) &&
+	    ((text[length - 1] == '\n') || (text[length - 1] == '\r'))) {
+		terminated = 1;
+		length -= 1;
+		if ((length > 0) && (text[length - 1] != text[length]) &&
+		    ((text[length - 1] == '\n') || (text[length - 1] == '\r'))) {
+			length -= 1;
+		}
+	}
+	if (length == 0) {
+		terminated = 1;
+	}
+
+	if ((memchr(text, '\n', length) != NULL) ||
+	    (memchr(text, '\r', length) != NULL)) {
+		return EINVAL;
+	}
+
+	start = elastic_print_clock();
+
+	old_text = eprint->lines[line];
+	old_chunk = eprint->lines_chunk[line];
+	old_length = eprint->lines_length[line];
+	old_first = eprint->lines_cells_first[line];
+	old_cells = eprint->lines_cells[line];
+
+	/* the new line is added behind all others first, so nothing changes if
+	 * this fails */
+	rc = elastic_print_add_single(eprint, text, length, terminated, 0);
+	eprint->stats.bytes_added += length;
+	if (rc != 0) {
+		eprint->stats.add_nsec += elastic_print_clock() - start;
+		return rc;
+	}
+
+	elastic_print_line_unaccount(eprint, line);
+
+	eprint->lines_count -= 1;
+	elastic_print_line_move(eprint, line, eprint->lines_count);
+
+	/* the new cells are the last ones, they are moved to where the old
+	 * ones were if they fit */
+	cells = eprint->lines_cells[line];
+	if ((cells > 0) && (cells <= old_cells)) {
+		memcpy(&(eprint->cells_length[old_first]),
+		       &(eprint->cells_length[eprint->cells_count - cells]),
+		       cells * sizeof(*eprint->cells_length));
+		memcpy(&(eprint->cells_width[old_first]),
+		       &(eprint->cells_width[eprint->cells_count - cells]),
+		       cells * sizeof(*eprint->cells_width));
+
+		eprint->lines_cells_first[line] = old_first;
+		eprint->cells_count -= cells;
+		elastic_print_cells_release(eprint, old_first + cells,
+					    old_cells - cells);
+	} else {
+		elastic_print_cells_release(eprint, old_first, old_cells);
+	}
+
+	/* the same goes for the text, which was stored with its newline */
+	if (old_chunk == NULL) {
+		eprint->lines_borrowed -= 1;
+	} else if (length <= old_length) {
+		memcpy((char *) old_text, eprint->lines[line], length + 1);
+		text = eprint->lines[line];
+		chunk = eprint->lines_chunk[line];
+		eprint->lines[line] = old_text;
+		eprint->lines_chunk[line] = old_chunk;
+
+		/* that can move the line out of its chunk already */
+		elastic_print_text_release(eprint, chunk, text, length);
+		if (eprint->lines[line] == old_text) {
+			elastic_print_chunk_release(eprint, old_chunk,
+						    &old_text[length + 1],
+						    old_length - length);
+		}
+	} else {
+		elastic_print_chunk_release(eprint, old_chunk, old_text,
+					    old_length + 1);
+	}
+
+	eprint->stats.add_nsec += elastic_print_clock() - start;
+	return 0;
+}
+
+int elastic_print_remove_line(struct elastic_print *eprint, size_t line)
+{
+	const char *text;
+	struct elastic_print_chunk *chunk;
+	size_t length, first, cells, count;
+
+	if ((eprint == NULL) || (eprint->histograms == NULL) ||
+	    (line >= eprint->lines_count)) {
+		return EINVAL;
+	}
+
+	text = eprint->lines[line];
+	chunk = eprint->lines_chunk[line];
+	length = eprint->lines_length[line];
+	first = eprint->lines_cells_first[line];
+	cells = eprint->lines_cells[line];
+
+	elastic_print_line_unaccount(eprint, line);
+
+	eprint->lines_count -= 1;
+	count = eprint->lines_count - line;
+
+#define __remove(array)                                                        \
+	{                                                                      \
+		memmove(&(eprint->array[line]), &(eprint->array[line + 1]),    \
+			count * sizeof(*eprint->array));                       \
+	}
+
+	__remove(lines);
+	__remove(lines_length);
+	__remove(lines_cells);
+	__remove(lines_cells_first);
+	__remove(lines_chunk);
+
+#undef __remove
+
+	elastic_print_cells_release(eprint, first, cells);
+	elastic_print_text_release(eprint, chunk, text, length);
+
+	return 0;
+}
+
+/** returns how many threads to use for `size` bytes of work, with at most
+ * `threads` of them (0 means one per online CPU) */
+static size_t elastic_print_threads(unsigned int threads, size_t size)
+{
+	long online;
+	size_t count;
+
+	if (threads == 0) {
+		online = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = (online > 0) ? (unsigned int) online : 1;
+	}
+	if (threads > ELASTIC_PRINT_BULK_THREADS) {
+		threads = ELASTIC_PRINT_BULK_THREADS;
+	}
+
+	count = size / ELASTIC_PRINT_BULK_MIN;
+	if (count > threads) {
+		count = threads;
+	}
+
+	return count;
+}
+
+/** one part of the input of `elastic_print_add_bulk()` and the private
+ * instance it is measured into */
+struct elastic_print_bulk
+{
+	/** private instance with the same settings as the target */
+	struct elastic_print	eprint;
+	/** the part of the input, starting at the beginning of a line */
+	const char *		text;
+	size_t			length;
+	/** whether the input ends with a '\0' in this part */
+	int			truncated;
+	/** see `elastic_print_add_single()` */
+	int			borrowed;
+	int			rc;
+	pthread_t		thread;
+	int			started;
+};
+
+/** measures one part of the input of `elastic_print_add_bulk()` */
+static void *elastic_print_bulk_worker(void *arg)
+{
+	struct elastic_print_bulk *part = arg;
+	const char *end;
+
+	end = memchr(part->text, '\0', part->length);
+	if (end != NULL) {
+		part->truncated = 1;
+	} else {
+		end = part->text + part->length;
+	}
+
+	part->rc = elastic_print_add_text(&part->eprint, part->text, end,
+					  part->borrowed);
+
+	return NULL;
+}
+
+/** accounts for the column widths and output of the lines in `from`, as if
+ * they were added to `eprint`, which MUST have at least as many columns
+ *
+ * Only for instances without column blocks, the lines themselves are not
+ * touched.
+ */
+static void elastic_print_merge_widths(struct elastic_print *eprint,
+				       const struct elastic_print *from)
+{
+	size_t column, cell, width;
+
+	/* the output of both parts only grows by the difference of their
+	 * widths to the new ones, for every cell they have */
+	elastic_print_output_grow(eprint, 1, from->output_length);
+	eprint->output_overflow |= from->output_overflow;
+
+	for (column = 0; column < from->columns; column++) {
+		width = eprint->column_widths[column];
+		if (width < from->column_widths[column]) {
+			width = from->column_widths[column];
+		}
+
+		cell = eprint->column_cells[column];
+		elastic_print_output_grow(eprint, cell,
+					  width - eprint->column_widths[column]);
+		cell = from->column_cells[column];
+		elastic_print_output_grow(eprint, cell,
+					  width - from->column_widths[column]);
+
+		eprint->column_widths[column] = width;
+		eprint->column_cells[column] += cell;
+	}
+}
+
+/** hands the storage-chunks (and statistics) of `from` over to `eprint` */
+static void elastic_print_merge_storage(struct elastic_print *eprint,
+					struct elastic_print *from)
+{
+	struct elastic_print_chunk *chunk;
+
+	eprint->lines_borrowed += from->lines_borrowed;
+	from->lines_borrowed = 0;
+
+	eprint->stats.lines_added += from->stats.lines_added;
+	eprint->stats.bytes_added += from->stats.bytes_added;
+	eprint->stats.bytes_stored += from->stats.bytes_stored;
+	eprint->stats.bytes_borrowed += from->stats.bytes_borrowed;
+	eprint->stats.bytes_storage += from->stats.bytes_storage;
+	eprint->stats.allocs += from->stats.allocs;
+	eprint->stats.reallocs += from->stats.reallocs;
+	eprint->stats.add_nsec += from->stats.add_nsec;
+	memset(&from->stats, 0, sizeof(from->stats));
+
+	/* the stored lines point into these */
+	if (from->chunks != NULL) {
+		for (chunk = from->chunks; chunk->next != NULL;
+		     chunk = chunk->next) {
+			/* find the end */
+		}
+
+		if (eprint->chunks != NULL) {
+			chunk->next = eprint->chunks->next;
+			eprint->chunks->next = from->chunks;
+		} else {
+			eprint->chunks = from->chunks;
+		}
+		from->chunks = NULL;
+	}
+}
+
+/** appends all lines measured in `part` to `eprint`
+ *
+ * The text stays where it was stored by the worker, its storage-chunks are
+ * handed over to `eprint`. Nothing is changed in `eprint` if ENOMEM is
+ * returned, except for column blocks, where the lines up to the failing one
+ * are kept.
+ */
+static int elastic_print_bulk_merge(struct elastic_print *eprint,
+				    struct elastic_print_bulk *part)
+{
+	struct elastic_print *from = &(part->eprint);
+	size_t line, lines_base, cells_base;
+	int rc;
+
+	if (from->lines_count == 0) {
+		return 0;
+	}
+
+	rc = elastic_print_lines_reserve(eprint, from->lines_count);
+	if (rc != 0) {
+		return rc;
+	}
+	rc = elastic_print_cells_reserve(eprint, from->cells_count);
+	if (rc != 0) {
+		return rc;
+	}
+	rc = elastic_print_columns_reserve(eprint, from->columns);
+	if (rc != 0) {
+		return rc;
+	}
+
+	lines_base = eprint->lines_count;
+	cells_base = eprint->cells_count;
+
+#define __append(array, count, base)                                           \
+	{                                                                      \
+		if ((count) > 0) {                                             \
+			memcpy(&(eprint->array[(base)]), from->array,          \
+			       (count) * sizeof(*eprint->array));              \
+		}                                                              \
+	}
+
+	__append(lines, from->lines_count, lines_base);
+	__append(lines_length, from->lines_count, lines_base);
+	__append(lines_cells, from->lines_count, lines_base);
+	__append(cells_length, from->cells_count, cells_base);
+	__append(cells_width, from->cells_count, cells_base);
+
+#undef __append
+
+	for (line = 0; line < from->lines_count; line++) {
+		eprint->lines_cells_first[lines_base + line] =
+		    from->lines_cells_first[line] + cells_base;
+	}
+
+	if (eprint->blocks != NULL) {
+		/* the blocks of a part depend on the lines in front of it,
+		 * so they are accounted for line by line */
+		for (line = lines_base; line < (lines_base + from->lines_count);
+		     line++) {
+			eprint->lines_count = line + 1;
+
+			rc = elastic_print_blocks_add(eprint,
+						      eprint->lines_cells[line]);
+			if (rc != 0) {
+				eprint->lines_count = line;
+				goto out_chunks;
+			}
+
+			eprint->cells_count += eprint->lines_cells[line];
+			elastic_print_output_grow(eprint, 1,
+						  eprint->lines_length[line] + 1);
+		}
+	} else {
+		elastic_print_merge_widths(eprint, from);
+
+		eprint->lines_count += from->lines_count;
+		eprint->cells_count += from->cells_count;
+	}
+
+out_chunks:
+	elastic_print_merge_storage(eprint, from);
+
+	return rc;
+}
+
+/** moves the lines of all shards into `eprint`, in the order of the
+ * sequence numbers of their runs, see `ELASTIC_PRINT_CONCURRENT`
+ *
+ * \returns ENOMEM	in case the index could not be grown, nothing is
+ *			changed then
+ * \returns 0		if everything went OK
+ */
+static int elastic_print_gather(struct elastic_print *eprint)
+{
+	struct elastic_print_shard *shard, *next;
+	struct elastic_print *from;
+	size_t lines = 0, cells = 0, columns = 0;
+	size_t line, first, end, count, base;
+	int rc;
+
+	if (eprint->concurrent == NULL) {
+		return 0;
+	}
+
+	for (shard = eprint->concurrent->shards; shard != NULL;
+	     shard = shard->next) {
+		lines += shard->eprint.lines_count;
+		cells += shard->eprint.cells_count;
+		if (columns < shard->eprint.columns) {
+			columns = shard->eprint.columns;
+		}
+	}
+
+	if (lines == 0) {
+		return 0;
+	}
+
+	rc = elastic_print_lines_reserve(eprint, lines);
+	if (rc != 0) {
+		return rc;
+	}
+	rc = elastic_print_cells_reserve(eprint, cells);
+	if (rc != 0) {
+		return rc;
+	}
+	rc = elastic_print_columns_reserve(eprint, columns);
+	if (rc != 0) {
+		return rc;
+	}
+
+	/* the run with the lowest number left is always taken next; there
+	 * are only as many shards as threads ever added */
+	for (;;) {
+		next = NULL;
+		for (shard = eprint->concurrent->shards; shard != NULL;
+		     shard = shard->next) {
+			if ((shard->runs_merged < shard->runs_count) &&
+			    ((next == NULL) ||
+			     (shard->runs[shard->runs_merged].seq <
+			      next->runs[next->runs_merged].seq))) {
+				next = shard;
+			}
+		}
+
+		if (next == NULL) {
+			break;
+		}
+
+		from = &(next->eprint);
+		first = (next->runs_merged > 0) ?
+			    next->runs[next->runs_merged - 1].end :
+			    0;
+		end = next->runs[next->runs_merged].end;
+		next->runs_merged += 1;
+
+		count = end - first;
+		base = from->lines_cells_first[first];
+		cells = from->lines_cells_first[end - 1] +
+			from->lines_cells[end - 1] - base;
+
+#define __append(array, count, to, from_index)                                 \
+	{                                                                      \
+		if ((count) > 0) {                                             \
+			memcpy(&(eprint->array[(to)]),                         \
+			       &(from->array[(from_index)]),                   \
+			       (count) * sizeof(*eprint->array));              \
+		}                                                              \
+	}
+
+		__append(lines, count, eprint->lines_count, first);
+		__append(lines_length, count, eprint->lines_count, first);
+		__append(lines_cells, count, eprint->lines_count, first);
+		__append(cells_length, cells, eprint->cells_count, base);
+		__append(cells_width, cells, eprint->cells_count, base);
+
+#undef __append
+
+		for (line = 0; line < count; line++) {
+			eprint->lines_cells_first[eprint->lines_count + line] =
+			    from->lines_cells_first[first + line] - base +
+			    eprint->cells_count;
+		}
+
+		eprint->lines_count += count;
+		eprint->cells_count += cells;
+	}
+
+	for (shard = eprint->concurrent->shards; shard != NULL;
+	     shard = shard->next) {
+		elastic_print_merge_widths(eprint, &shard->eprint);
+		elastic_print_merge_storage(eprint, &shard->eprint);
+
+		elastic_print_clear(&shard->eprint);
+		shard->runs_count = 0;
+		shard->runs_merged = 0;
+	}
+
+	return 0;
+}
+
+/** returns the output length of the lines in `from` with the widths
+ * published in concurrent mode, see `elastic_print_gather()`
+ *
+ * \returns SIZE_MAX	if the length doesn't fit a `size_t`
+ */
+static size_t elastic_print_concurrent_length(
+    const struct elastic_print *eprint, const struct elastic_print *from)
+{
+	size_t length = from->output_length, column, grow;
+
+	if (from->output_overflow) {
+		return SIZE_MAX;
+	}
+
+	for (column = 0; column < from->columns; column++) {
+		if (__builtin_mul_overflow(from->column_cells[column],
+					   eprint->concurrent->widths[column] -
+					       from->column_widths[column],
+					   &grow) ||
+		    __builtin_add_overflow(length, grow, &length)) {
+			return SIZE_MAX;
+		}
+	}
+
+	return length;
+}
+
+/** `elastic_print_add_bulk()` that can borrow the lines from `buffer`
+ *
+ * \para borrowed	see `elastic_print_add_single()`
+ */
+static int elastic_print_add_parts(struct elastic_print *eprint,
+				   const char *buffer, size_t length,
+				   unsigned int threads, int borrowed)
+{
+	int rc;
+
+	struct elastic_print_bulk *parts;
+	size_t count, i, pos, split;
+	const char *nl;
+	uint64_t start;
+
+	if ((eprint == NULL) || ((buffer == NULL) && (length > 0))) {
+		rc = EINVAL;
+		goto err;
+	}
+	if ((length == 0) || (buffer[0] == '\0')) {
+		rc = 0;
+		goto err;
+	}
+
+	count = elastic_print_threads(threads, length);
+
+	if ((count < 2) || (eprint->stream_fd >= 0) ||
+	    (eprint->histograms != NULL) || (eprint->concurrent != NULL) ||
+	    (eprint->spill != NULL)) {
+		/* not worth any thread; in streaming and spill mode the lines
+		 * have to be written out while they come in anyway, the
+		 * histograms are only kept up to date by this, and in
+		 * concurrent mode other threads can add at the same time */
+		rc = elastic_print_add_input(eprint, buffer, length, borrowed);
+		goto err;
+	}
+
+	start = elastic_print_clock();
+
+	parts = calloc(count, sizeof(*parts));
+	if (parts == NULL) {
+		rc = ENOMEM;
+		goto err;
+	}
+	eprint->stats.allocs += 1;
+
+	/* each part ends behind a '\n' that is a line-break on its own, so
+	 * it ends a line no matter how the parts before it are split up */
+	pos = 0;
+	for (i = 0; (i < count) && (pos < length); i++) {
+		rc = elastic_print_part_init(eprint, &parts[i].eprint);
+		if (rc != 0) {
+			count = i + 1;
+			goto err_destroy_parts;
+		}
+
+		parts[i].text = &buffer[pos];
+		parts[i].length = length - pos;
+		parts[i].borrowed = borrowed;
+
+		split = (length / count) * (i + 1);
+		if ((i == (count - 1)) || (split <= pos)) {
+			pos = length;
+			continue;
+		}
+
+		while ((nl = memchr(&buffer[split], '\n', length - split)) !=
+		       NULL) {
+			split = (size_t)(nl - buffer) + 1;
+			if ((split == length) || ((nl[-1] != '\r') &&
+						  (buffer[split] != '\r'))) {
+				break;
+			}
+		}
+
+		if ((nl == NULL) || (split == length)) {
+			pos = length;
+			continue;
+		}
+
+		parts[i].length = split - pos;
+		pos = split;
+	}
+	count = i;
+
+	/* the first part is measured by this thread */
+	for (i = 1; i < count; i++) {
+		rc = pthread_create(&parts[i].thread, NULL,
+				    elastic_print_bulk_worker, &parts[i]);
+		if (rc != 0) {
+			goto err_join_parts;
+		}
+		parts[i].started = 1;
+	}
+
+	elastic_print_bulk_worker(&parts[0]);
+
+	/* the parts are merged in order, as soon as they are finished */
+	rc = 0;
+	for (i = 0; i < count; i++) {
+		if (parts[i].started) {
+			pthread_join(parts[i].thread, NULL);
+			parts[i].started = 0;
+		}
+
+		if (rc == 0) {
+			rc = parts[i].rc;
+		}
+		if (rc == 0) {
+			rc = elastic_print_bulk_merge(eprint, &parts[i]);
+		}
+		if (parts[i].truncated) {
+			/* everything behind a 0-terminator is ignored */
+			break;
+		}
+	}
+
+err_join_parts:
+	for (i = 0; i < count; i++) {
+		if (parts[i].started) {
+			pthread_join(parts[i].thread, NULL);
+		}
+	}
+err_destroy_parts:
+	for (i = 0; i < count; i++) {
+		elastic_print_release(&parts[i].eprint);
+	}
+	free(parts);
+	eprint->stats.add_nsec += elastic_print_clock() - start;
+err:
+	return rc;
+}
+
+int elastic_print_add_bulk(struct elastic_print *eprint, const char *buffer,
+			   size_t length, unsigned int threads)
+{
+	return elastic_print_add_parts(eprint, buffer, length, threads, 0);
+}
+
+/** adds everything that can be read from `fd` in pieces of complete lines,
+ * so the input doesn't have to fit into memory in spill mode
+ *
+ * \returns errno	as reported by `read()`
+ * \returns `elastic_print_add_line()`
+ */
+static int elastic_print_add_fd_pieces(struct elastic_print *eprint, int fd)
+{
+	int rc = 0;
+
+	char *buffer, *grown, *nul;
+	size_t length = 0, size = ELASTIC_PRINT_CHUNK_SIZE, cut;
+	ssize_t got;
+
+#define __is_break(c) (((c) == '\n') || ((c) == '\r'))
+
+	buffer = malloc(size);
+	if (buffer == NULL) {
+		return ENOMEM;
+	}
+	eprint->stats.allocs += 1;
+
+	for (;;) {
+		if (length == size) {
+			/* a single line that is longer than the buffer */
+			if (size > (SIZE_MAX / 2)) {
+				rc = ENOMEM;
+				goto err_free_buffer;
+			}
+			grown = realloc(buffer, size * 2);
+			if (grown == NULL) {
+				rc = ENOMEM;
+				goto err_free_buffer;
+			}
+			eprint->stats.reallocs += 1;
+			buffer = grown;
+			size *= 2;
+		}
+
+		got = read(fd, &buffer[length], size - length);
+		if (got < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			rc = errno;
+			goto err_free_buffer;
+		}
+		if (got == 0) {
+			break;
+		}
+
+		/* everything behind a 0-terminator is ignored */
+		nul = memchr(&buffer[length], '\0', (size_t) got);
+		if (nul != NULL) {
+			length = (size_t) (nul - buffer);
+			break;
+		}
+		length += (size_t) got;
+
+		/* the input is cut behind the last line-break that is
+		 * followed by a line, as a break at the end could still be
+		 * the first half of "\r\n" */
+		for (cut = length - 1; cut > 0; cut--) {
+			if (__is_break(buffer[cut - 1]) &&
+			    !__is_break(buffer[cut])) {
+				break;
+			}
+		}
+		if (cut == 0) {
+			continue;
+		}
+
+		rc = elastic_print_add_line(eprint, buffer, cut);
+		if (rc != 0) {
+			goto err_free_buffer;
+		}
+
+		length -= cut;
+		memmove(buffer, &buffer[cut], length);
+	}
+
+#undef __is_break
+
+	rc = elastic_print_add_line(eprint, buffer, length);
+err_free_buffer:
+	free(buffer);
+	return rc;
+}
+
+/** adds the lines of the file mapped at `[buffer, buffer + length)`, and
+ * takes over the mapping
+ *
+ * The lines are borrowed from the mapping, so it is kept until the instance
+ * is reset or destroyed. Only in spill mode, where the lines are copied
+ * anyway, it is unmapped right away.
+ *
+ * \returns ENOMEM	in case not enough memory could be allocated
+ * \returns `elastic_print_add_bulk()`
+ */
+static int elastic_print_add_mapping(struct elastic_print *eprint,
+				     char *buffer, size_t length,
+				     unsigned int threads)
+{
+	struct elastic_print_mapping *mapping;
+	int rc;
+
+	if (eprint->spill != NULL) {
+		rc = elastic_print_add_parts(eprint, buffer, length, threads, 0);
+		munmap(buffer, length);
+		return rc;
+	}
+
+	mapping = malloc(sizeof(*mapping));
+	if (mapping == NULL) {
+		munmap(buffer, length);
+		return ENOMEM;
+	}
+	eprint->stats.allocs += 1;
+
+	mapping->addr = buffer;
+	mapping->length = length;
+
+	/* in concurrent mode other threads can push theirs at the same time */
+	mapping->next = __atomic_load_n(&eprint->mappings, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&eprint->mappings, &mapping->next,
+					    mapping, 1, __ATOMIC_RELEASE,
+					    __ATOMIC_RELAXED)) {
+		/* `mapping->next` was updated, try again */
+	}
+
+	return elastic_print_add_parts(eprint, buffer, length, threads, 1);
+}
+
+int elastic_print_add_fd(struct elastic_print *eprint, int fd,
+			 unsigned int threads)
+{
+	int rc;
+
+	struct stat st;
+	char *buffer, *grown;
+	size_t length, size;
+	ssize_t got;
+
+	if ((eprint == NULL) || (fd < 0)) {
+		rc = EINVAL;
+		goto err;
+	}
+
+	if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0) &&
+	    ((uintmax_t) st.st_size <= SIZE_MAX)) {
+		/* regular files are measured right in the page-cache */
+		length = (size_t) st.st_size;
+		buffer = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (buffer != MAP_FAILED) {
+			rc = elastic_print_add_mapping(eprint, buffer, length,
+						       threads);
+			goto err;
+		}
+	}
+
+	if (eprint->spill != NULL) {
+		rc = elastic_print_add_fd_pieces(eprint, fd);
+		goto err;
+	}
+
+	/* everything else is read in completely, so it can be split up */
+	size = ELASTIC_PRINT_CHUNK_SIZE;
+	length = 0;
+	buffer = malloc(size);
+	if (buffer == NULL) {
+		rc = ENOMEM;
+		goto err;
+	}
+	eprint->stats.allocs += 1;
+
+	for (;;) {
+		if (length == size) {
+			if (size > (SIZE_MAX / 2)) {
+				rc = ENOMEM;
+				goto err_free_buffer;
+			}
+			grown = realloc(buffer, size * 2);
+			if (grown == NULL) {
+				rc = ENOMEM;
+				goto err_free_buffer;
+			}
+			eprint->stats.reallocs += 1;
+			buffer = grown;
+			size *= 2;
+		}
+
+		got = read(fd, &buffer[length], size - length);
+		if (got < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			rc = errno;
+			goto err_free_buffer;
+		}
+		if (got == 0) {
+			break;
+		}
+		length += (size_t) got;
+	}
+
+	rc = elastic_print_add_bulk(eprint, buffer, length, threads);
+err_free_buffer:
+	free(buffer);
+err:
+	return rc;
+}
+
+/** returns the number of bytes of output from `line` on, that can be
+ * copied at once from where the lines are kept, and the line behind them in
+ * `*next`; only for instances without any elastic column
+ *
+ * Stored lines are followed by their newline, so the output of lines that
+ * are stored one right behind the other is already in the storage, with the
+ * newline of the last one. As long as there are borrowed lines, which are
+ * not followed by a newline for sure, only one line without its newline is
+ * returned.
+ */
+static size_t elastic_print_passthrough_run(const struct elastic_print *eprint,
+					    size_t line, size_t last,
+					    size_t *next)
+{
+	size_t length = eprint->lines_length[line];
+
+	*next = line + 1;
+	if (eprint->lines_borrowed > 0) {
+		return length;
+	}
+
+	while ((*next < last) &&
+	       (eprint->lines[*next] == (eprint->lines[line] + length + 1))) {
+		length += 1 + eprint->lines_length[*next];
+		*next += 1;
+	}
+
+	return length + 1;
+}
+
+/** renders the lines `[first, last)` of a instance without any elastic
+ * column into `out`, which MUST be big enough
+ *
+ * \returns the end of the output in `out`
+ */
+static char *elastic_print_render_passthrough(
+    const struct elastic_print *eprint, size_t first, size_t last, char *out)
+{
+	size_t line, next, length;
+
+	for (line = first; line < last; line = next) {
+		length = elastic_print_passthrough_run(eprint, line, last, &next);
+		memcpy(out, eprint->lines[line], length);
+		out += length;
+
+		if (eprint->lines_borrowed > 0) {
+			*out++ = '\n';
+		}
+	}
+
+	return out;
+}
+
+/*
+ * Renderers for a few fixed numbers of columns
+ *
+ * Most tables only have a handful of columns. Instances with up to
+ * `ELASTIC_PRINT_FIXED_MAX` columns and without column blocks are rendered
+ * into buffers known to be big enough by one of these, with the column widths
+ * in a local array, and the loop over the cells of a line bound by a
+ * constant, so the compiler can unroll it.
+ */
+
+#define ELASTIC_PRINT_FIXED_MAX	8
+
+#define __render_fixed(n)                                                      \
+	static char *elastic_print_render_fixed##n(                            \
+	    const struct elastic_print *eprint, size_t first, size_t last,     \
+	    char *out)                                                         \
+	{                                                                      \
+		size_t widths[(n)];                                            \
+		size_t line, column, cell, cells;                              \
+		const char *cur, *end;                                         \
+                                                                               \
+		memcpy(widths, eprint->column_widths, sizeof(widths));         \
+                                                                               \
+		for (line = first; line < last; line++) {                      \
+			cur = eprint->lines[line];                             \
+			end = cur + eprint->lines_length[line];                \
+			cell = eprint->lines_cells_first[line];                \
+			cells = eprint->lines_cells[line];                     \
+                                                                               \
+			for (column = 0; column < (n); column++, cell++) {     \
+				if (column == cells) {                         \
+					break;                                 \
+				}                                              \
+                                                                               \
+				memcpy(out, cur, eprint->cells_length[cell]);  \
+				out += eprint->cells_length[cell];             \
+				memset(out, ' ',                               \
+				       widths[column] -                        \
+					   eprint->cells_width[cell]);         \
+				out += widths[column] -                        \
+				       eprint->cells_width[cell];              \
+                                                                               \
+				cur += eprint->cells_length[cell] + 1;         \
+			}                                                      \
+                                                                               \
+			if (cur < end) {                                       \
+				memcpy(out, cur, (size_t) (end - cur));        \
+				out += end - cur;                              \
+			}                                                      \
+                                                                               \
+			*out++ = '\n';                                         \
+		}                                                              \
+                                                                               \
+		return out;                                                    \
+	}
+
+__render_fixed(1)
+__render_fixed(2)
+__render_fixed(3)
+__render_fixed(4)
+__render_fixed(5)
+__render_fixed(6)
+__render_fixed(7)
+__render_fixed(8)
+
+#undef __render_fixed
+
+/** the renderer for each number of columns, see above */
+static char *(*const elastic_print_render_fixed[ELASTIC_PRINT_FIXED_MAX + 1])(
+    const struct elastic_print *eprint, size_t first, size_t last,
+    char *out) = {
+	elastic_print_render_passthrough, elastic_print_render_fixed1,
+	elastic_print_render_fixed2,	  elastic_print_render_fixed3,
+	elastic_print_render_fixed4,	  elastic_print_render_fixed5,
+	elastic_print_render_fixed6,	  elastic_print_render_fixed7,
+	elastic_print_render_fixed8,
+};
+
+/** whether `eprint` can be rendered by `elastic_print_render_fixed` */
+static inline int elastic_print_fixed(const struct elastic_print *eprint)
+{
+	return (eprint->columns == 0) ||
+	       ((eprint->blocks == NULL) &&
+		(eprint->columns <= ELASTIC_PRINT_FIXED_MAX));
+}
+
+ssize_t elastic_print_snput_ssize(struct elastic_print *eprint, char *buffer,
+				  size_t buffer_len)
+{
+	ssize_t rc;
+	size_t line, column, cell, bleft, width;
+	size_t *cursor;
+	const char *cur, *end;
+	char *cur_buf;
+	uint64_t start;
+
+	if ((eprint == NULL) || (buffer == NULL) || (buffer_len < 1)) {
+		rc = -EINVAL;
+		goto err;
+	}
+
+	buffer[0] = '\0';
+	buffer[buffer_len - 1] = '\0';
+
+	start = elastic_print_clock();
+	cur_buf = &(buffer[0]);
+	/* the last character is reserved for the 0-terminator */
+	bleft = buffer_len - 1;
+
+	rc = -elastic_print_gather(eprint);
+	if (rc == 0) {
+		rc = -elastic_print_spill_map(eprint);
+	}
+	if (rc != 0) {
+		goto err_terminate;
+	}
+
+	if (elastic_print_fixed(eprint) && !eprint->output_overflow &&
+	    (eprint->output_length <= bleft)) {
+		cur_buf = elastic_print_render_fixed[eprint->columns](
+		    eprint, 0, eprint->lines_count, cur_buf);
+		goto out;
+	}
+
+	rc = -elastic_print_cursor_alloc(eprint, &cursor);
+	if (rc != 0) {
+		goto err_terminate;
+	}
+
+#define __check_left(len)                                                      \
+	{                                                                      \
+		if ((len) > bleft) {                                           \
+			rc = -ENOMEM;                                          \
+			goto err_terminate;                                    \
+		}                                                              \
+		bleft -= (len);                                                \
+	}
+#define __append_span(src, len)                                                \
+	{                                                                      \
+		__check_left(len);                                             \
+		memcpy(cur_buf, (src), (len));                                 \
+		cur_buf += (len);                                              \
+	}
+#define __append_fill(c, len)                                                  \
+	{                                                                      \
+		__check_left(len);                                             \
+		memset(cur_buf, (c), (len));                                   \
+		cur_buf += (len);                                              \
+	}
+
+	for (line = 0; line < eprint->lines_count; line += 1) {
+		cur = eprint->lines[line];
+		end = cur + eprint->lines_length[line];
+		cell = eprint->lines_cells_first[line];
+
+		elastic_print_cursor_step(eprint, cursor, line);
+
+		for (column = 0; column < eprint->lines_cells[line];
+		     column += 1, cell += 1) {
+			__append_span(cur, eprint->cells_length[cell]);
+
+			width = elastic_print_cursor_width(eprint, cursor,
+							   column);
+			assert(eprint->cells_width[cell] < width);
+
+			__append_fill(' ', width - eprint->cells_width[cell]);
+
+			/* skip the finishing tab; the closing elastic tab of
+			 * a line is not stored, so this can go past `end` */
+			cur += eprint->cells_length[cell] + 1;
+		}
+
+		if (cur < end) {
+			__append_span(cur, (size_t) (end - cur));
+		}
+
+		__append_fill('\n', 1);
+	}
+
+#undef __append_fill
+#undef __append_span
+#undef __check_left
+
+out:
+	rc = (ssize_t) (cur_buf - buffer);
+err_terminate:
+	*cur_buf = '\0';
+	eprint->stats.renders += 1;
+	eprint->stats.bytes_rendered += (size_t) (cur_buf - buffer);
+	eprint->stats.render_nsec += elastic_print_clock() - start;
+err:
+	return rc;
+}
+
+int elastic_print_snput(struct elastic_print *eprint, char *buffer,
+			size_t buffer_len)
+{
+	ssize_t rc;
+
+	rc = elastic_print_snput_ssize(eprint, buffer, buffer_len);
+	if (rc > INT_MAX) {
+		return -EOVERFLOW;
+	}
+
+	return (int) rc;
+}
+
+/** one range of lines rendered by `elastic_print_snput_threads()` */
+struct elastic_print_render
+{
+	const struct elastic_print *	eprint;
+	/** the lines `[first, last)` of the range */
+	size_t				first;
+	size_t				last;
+	/** block-cursors used while going through the range, followed by
+	 * the ones the range starts with; NULL without blocks */
+	size_t *			cursor;
+	/** length of the output of the range */
+	size_t				length;
+	/** where the output of the range starts */
+	char *				out;
+	pthread_t			thread;
+	int				started;
+};
+
+/** counts the blocks started in one range of lines */
+static void *elastic_print_render_blocks(void *arg)
+{
+	struct elastic_print_render *range = arg;
+	size_t line;
+
+	for (line = range->first; line < range->last; line++) {
+		elastic_print_cursor_step(range->eprint, range->cursor, line);
+	}
+
+	return NULL;
+}
+
+/** measures the output of one range of lines */
+static void *elastic_print_render_measure(void *arg)
+{
+	struct elastic_print_render *range = arg;
+	const struct elastic_print *eprint = range->eprint;
+	size_t line, column, cell, rest, length = 0;
+
+	for (line = range->first; line < range->last; line++) {
+		elastic_print_cursor_step(eprint, range->cursor, line);
+
+		/* the closing elastic tab of a line is not stored, so the
+		 * cells can span more than the line itself */
+		rest = eprint->lines_length[line];
+		cell = eprint->lines_cells_first[line];
+
+		for (column = 0; column < eprint->lines_cells[line];
+		     column += 1, cell += 1) {
+			length += eprint->cells_length[cell] +
+				  elastic_print_cursor_width(eprint,
+							     range->cursor,
+							     column) -
+				  eprint->cells_width[cell];
+
+			if (rest > eprint->cells_length[cell]) {
+				rest -= eprint->cells_length[cell] + 1;
+			} else {
+				rest = 0;
+			}
+		}
+
+		length += rest + 1;
+	}
+
+	range->length = length;
+
+	return NULL;
+}
+
+/** renders one range of lines into `range->out`, which MUST be big enough
+ * for it */
+static void *elastic_print_render_lines(void *arg)
+{
+	struct elastic_print_render *range = arg;
+	const struct elastic_print *eprint = range->eprint;
+	size_t line, column, cell, width;
+	const char *cur, *end;
+	char *out = range->out;
+
+	if (elastic_print_fixed(eprint)) {
+		elastic_print_render_fixed[eprint->columns](eprint, range->first,
+							    range->last, out);
+		return NULL;
+	}
+
+	for (line = range->first; line < range->last; line++) {
+		cur = eprint->lines[line];
+		end = cur + eprint->lines_length[line];
+		cell = eprint->lines_cells_first[line];
+
+		elastic_print_cursor_step(eprint, range->cursor, line);
+
+		for (column = 0; column < eprint->lines_cells[line];
+		     column += 1, cell += 1) {
+			memcpy(out, cur, eprint->cells_length[cell]);
+			out += eprint->cells_length[cell];
+
+			width = elastic_print_cursor_width(eprint, range->cursor,
+							   column);
+			memset(out, ' ', width - eprint->cells_width[cell]);
+			out += width - eprint->cells_width[cell];
+
+			cur += eprint->cells_length[cell] + 1;
+		}
+
+		if (cur < end) {
+			memcpy(out, cur, (size_t) (end - cur));
+			out += end - cur;
+		}
+
+		*out++ = '\n';
+	}
+
+	return NULL;
+}
+
+/** runs `fn` for each of the `count` ranges, each in its own thread */
+static void elastic_print_render_run(struct elastic_print_render *ranges,
+				     size_t count, void *(*fn)(void *))
+{
+	size_t i;
+
+	for (i = 1; i < count; i++) {
+		ranges[i].started = (pthread_create(&ranges[i].thread, NULL, fn,
+						    &ranges[i]) == 0);
+	}
+
+	/* ranges that didn't get a thread are done by the calling one */
+	for (i = 0; i < count; i++) {
+		if (!ranges[i].started) {
+			fn(&ranges[i]);
+		}
+	}
+
+	for (i = 1; i < count; i++) {
+		if (ranges[i].started) {
+			pthread_join(ranges[i].thread, NULL);
+			ranges[i].started = 0;
+		}
+	}
+}
+
+ssize_t elastic_print_snput_threads_ssize(struct elastic_print *eprint,
+					  char *buffer, size_t buffer_len,
+					  unsigned int threads)
+{
+	ssize_t rc;
+
+	struct elastic_print_render *ranges;
+	size_t count, columns, i, column, offset;
+	size_t *cursors = NULL;
+	uint64_t start;
+
+	if ((eprint == NULL) || (buffer == NULL) || (buffer_len < 1)) {
+		rc = -EINVAL;
+		goto err;
+	}
+
+	rc = -elastic_print_gather(eprint);
+	if (rc == 0) {
+		rc = -elastic_print_spill_map(eprint);
+	}
+	if (rc != 0) {
+		goto err;
+	}
+
+	count = elastic_print_threads(threads, eprint->output_length);
+	if (count > eprint->lines_count) {
+		count = eprint->lines_count;
+	}
+
+	if ((count < 2) || eprint->output_overflow ||
+	    (eprint->output_length >= buffer_len)) {
+		/* too little to split up, or it doesn't fit anyway */
+		rc = elastic_print_snput_ssize(eprint, buffer, buffer_len);
+		goto err;
+	}
+
+	start = elastic_print_clock();
+
+	ranges = calloc(count, sizeof(*ranges));
+	if (ranges == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+	eprint->stats.allocs += 1;
+
+	columns = eprint->columns + 1;
+	if (eprint->blocks != NULL) {
+		cursors = calloc(count * columns * 2, sizeof(*cursors));
+		if (cursors == NULL) {
+			rc = -ENOMEM;
+			goto err_free_ranges;
+		}
+		eprint->stats.allocs += 1;
+	}
+
+	for (i = 0; i < count; i++) {
+		ranges[i].eprint = eprint;
+		ranges[i].first = (eprint->lines_count / count) * i;
+		ranges[i].last = (i == (count - 1)) ?
+				     eprint->lines_count :
+				     (eprint->lines_count / count) * (i + 1);
+		if (cursors != NULL) {
+			ranges[i].cursor = &cursors[i * columns * 2];
+		}
+	}
+
+#define __cursors_start()                                                      \
+	{                                                                      \
+		for (i = 0; (cursors != NULL) && (i < count); i++) {           \
+			memcpy(ranges[i].cursor, &ranges[i].cursor[columns],   \
+			       columns * sizeof(*cursors));                    \
+		}                                                              \
+	}
+
+	/* the widths of the column blocks depend on the lines in front of a
+	 * range, so first the blocks in each range are counted; the cursors
+	 * a range starts with are the sums of the ones in front of it */
+	if (cursors != NULL) {
+		elastic_print_render_run(ranges, count,
+					 elastic_print_render_blocks);
+
+		for (i = 1; i < count; i++) {
+			for (column = 0; column < columns; column++) {
+				ranges[i].cursor[columns + column] =
+				    ranges[i - 1].cursor[columns + column] +
+				    ranges[i - 1].cursor[column];
+			}
+		}
+	}
+
+	/* the same goes for the offsets of the output of each range */
+	__cursors_start();
+	elastic_print_render_run(ranges, count, elastic_print_render_measure);
+
+	offset = 0;
+	for (i = 0; i < count; i++) {
+		ranges[i].out = &buffer[offset];
+		offset += ranges[i].length;
+	}
+	if (offset != eprint->output_length) {
+		/* the ranges would be written past what was checked against
+		 * `buffer_len` */
+		buffer[0] = '\0';
+		rc = -EFAULT;
+		goto err_free_cursors;
+	}
+
+	__cursors_start();
+#undef __cursors_start
+
+	elastic_print_render_run(ranges, count, elastic_print_render_lines);
+
+	buffer[offset] = '\0';
+	rc = (ssize_t) offset;
+
+	eprint->stats.renders += 1;
+	eprint->stats.bytes_rendered += offset;
+	eprint->stats.render_nsec += elastic_print_clock() - start;
+
+err_free_cursors:
+	free(cursors);
+err_free_ranges:
+	free(ranges);
+err:
+	return rc;
+}
+
+int elastic_print_snput_threads(struct elastic_print *eprint, char *buffer,
+				size_t buffer_len, unsigned int threads)
+{
+	ssize_t rc;
+
+	rc = elastic_print_snput_threads_ssize(eprint, buffer, buffer_len,
+					       threads);
+	if (rc > INT_MAX) {
+		return -EOVERFLOW;
+	}
+
+	return (int) rc;
+}
+
+size_t elastic_print_measure(const struct elastic_print *eprint)
+{
+	const struct elastic_print_shard *shard;
+	size_t length;
+
+	if (eprint == NULL) {
+		return 0;
+	}
+
+	if (eprint->concurrent == NULL) {
+		return eprint->output_overflow ? SIZE_MAX :
+						 eprint->output_length;
+	}
+
+	/* the shards are not merged yet */
+	length = elastic_print_concurrent_length(eprint, eprint);
+	for (shard = eprint->concurrent->shards; shard != NULL;
+	     shard = shard->next) {
+		if (__builtin_add_overflow(
+			length, elastic_print_concurrent_length(eprint,
+								&shard->eprint),
+			&length)) {
+			return SIZE_MAX;
+		}
+	}
+
+	return length;
+}
+
+int elastic_print_sinkput(struct elastic_print *eprint,
+			  int (*sink)(void *ctx, const char *data,
+				      size_t length),
+			  void *ctx)
+{
+	int rc;
+
+	char *block;
+	size_t used = 0, part, emitted = 0;
+	uint64_t start;
+	size_t line, next, column, cell, width;
+	size_t *cursor;
+	const char *cur, *end, *src;
+
+	if ((eprint == NULL) || (sink == NULL)) {
+		rc = EINVAL;
+		goto err;
+	}
+
+	start = elastic_print_clock();
+
+	if (eprint->render_block == NULL) {
+		eprint->render_block = malloc(ELASTIC_PRINT_SINK_BLOCK);
+		if (eprint->render_block == NULL) {
+			rc = ENOMEM;
+			goto err;
+		}
+		eprint->stats.allocs += 1;
+	}
+	block = eprint->render_block;
+
+	rc = elastic_print_gather(eprint);
+	if (rc == 0) {
+		rc = elastic_print_spill_map(eprint);
+	}
+	if (rc != 0) {
+		goto err_count;
+	}
+
+	rc = elastic_print_cursor_alloc(eprint, &cursor);
+	if (rc != 0) {
+		goto err_count;
+	}
+
+#define __flush()                                                              \
+	{                                                                      \
+		rc = sink(ctx, block, used);                                   \
+		if (rc != 0) {                                                 \
+			goto err_count;                                        \
+		}                                                              \
+		emitted += used;                                               \
+		used = 0;                                                      \
+	}
+/* a piece longer than a block is split over as many as needed */
+#define __append(fill, len)                                                    \
+	{                                                                      \
+		size_t __left = (len);                                         \
+                                                                               \
+		while (__left > 0) {                                           \
+			if (used == ELASTIC_PRINT_SINK_BLOCK) {                \
+				__flush();                                     \
+			}                                                      \
+                                                                               \
+			part = ELASTIC_PRINT_SINK_BLOCK - used;                \
+			if (part > __left) {                                   \
+				part = __left;                                 \
+			}                                                      \
+                                                                               \
+			fill;                                                  \
+			used += part;                                          \
+			__left -= part;                                        \
+		}                                                              \
+	}
+#define __append_span(text, len)                                               \
+	{                                                                      \
+		src = (text);                                                  \
+		__append(memcpy(&block[used], src, part); src += part, len);   \
+	}
+#define __append_fill(c, len)                                                  \
+	{                                                                      \
+		__append(memset(&block[used], (c), part), len);                \
+	}
+
+	/* nothing is elastic, the lines are copied as they are */
+	for (line = 0; (eprint->columns == 0) && (line < eprint->lines_count);
+	     line = next) {
+		width = elastic_print_passthrough_run(eprint, line,
+						      eprint->lines_count, &next);
+		__append_span(eprint->lines[line], width);
+
+		if (eprint->lines_borrowed > 0) {
+			__append_fill('\n', 1);
+		}
+	}
+
+	for (line = 0; (eprint->columns > 0) && (line < eprint->lines_count);
+	     line += 1) {
+		cur = eprint->lines[line];
+		end = cur + eprint->lines_length[line];
+		cell = eprint->lines_cells_first[line];
+
+		elastic_print_cursor_step(eprint, cursor, line);
+
+		for (column = 0; column < eprint->lines_cells[line];
+		     column += 1, cell += 1) {
+			__append_span(cur, eprint->cells_length[cell]);
+
+			width = elastic_print_cursor_width(eprint, cursor,
+							   column);
+			__append_fill(' ', width - eprint->cells_width[cell]);
+
+			cur += eprint->cells_length[cell] + 1;
+		}
+
+		if (cur < end) {
+			__append_span(cur, (size_t) (end - cur));
+		}
+
+		__append_fill('\n', 1);
+	}
+
+	if (used > 0) {
+		__flush();
+	}
+
+#undef __append_fill
+#undef __append_span
+#undef __append
+#undef __flush
+
+	rc = 0;
+err_count:
+	eprint->stats.renders += 1;
+	eprint->stats.bytes_rendered += emitted;
+	eprint->stats.render_nsec += elastic_print_clock() - start;
+err:
+	return rc;
+}
+
+/** sink for `elastic_print_fput()` */
+static int elastic_print_fput_sink(void *ctx, const char *data, size_t length)
+{
+	if (fwrite(data, sizeof(*data), length, ctx) != length) {
+		return EOF;
+	}
+
+	return 0;
+}
+
+int elastic_print_fput(struct elastic_print * eprint, FILE * stream)
+{
+	if ((eprint == NULL) || (stream == NULL)) {
+		return EINVAL;
+	}
+
+	/* rendered in blocks, without ever holding all of the output */
+	return elastic_print_sinkput(eprint, elastic_print_fput_sink, stream);
+}
 
-int elastic_print_create(struct elastic_print *eprint, size_t columns,
-			 size_t column_widths_min)
+int elastic_print_fput_threads(struct elastic_print *eprint, FILE *stream,
+			       unsigned int threads)
 {
 	int rc;
-	size_t i;
 
-	if ((eprint == NULL) || (column_widths_min < 1)) {
+	char * buffer;
+	size_t buffer_len;
+	ssize_t written;
+
+	if ((eprint == NULL) || (stream == NULL)) {
 		rc = EINVAL;
 		goto err;
 	}
 
-	memset(eprint, 0, sizeof(*eprint));
+	/* the exact length is known, so one render is enough; unless it is
+	 * too long for one buffer */
+	buffer_len = elastic_print_measure(eprint);
+	if ((threads == 1) || (buffer_len >= SSIZE_MAX)) {
+		rc = elastic_print_fput(eprint, stream);
+		goto err;
+	}
+	buffer_len += 1;
 
-	eprint->columns = columns;
-	eprint->lines_count = 0;
-	eprint->column_widths_min = column_widths_min;
+	buffer = malloc(buffer_len * sizeof(*buffer));
+	if (buffer == NULL) {
+		rc = ENOMEM;
+		goto err;
+	}
+	eprint->stats.allocs += 1;
 
-	if (eprint->columns > 0) {
-		eprint->column_widths =
-		    calloc(eprint->columns, sizeof(*eprint->column_widths));
-		if (eprint->column_widths == NULL) {
-			rc = ENOMEM;
-			goto err;
-		}
-	} else {
-		eprint->column_widths = NULL;
+	written = elastic_print_snput_threads_ssize(eprint, buffer, buffer_len,
+						    threads);
+	if (written < 0) {
+		rc = (int) -written;
+		goto err_free_buffer;
 	}
+	assert((size_t) written == (buffer_len - 1));
 
-	for (i = 0; i < eprint->columns; i++) {
-		eprint->column_widths[i] = eprint->column_widths_min;
+	if (fwrite(buffer, sizeof(*buffer), (size_t) written, stream) !=
+	    (size_t) written) {
+		rc = EOF;
+		goto err_free_buffer;
 	}
 
+	/* success */
 	rc = 0;
+err_free_buffer:
+	free(buffer);
 err:
 	return rc;
 }
 
-void elastic_print_destory(struct elastic_print *eprint)
+/** writes all of `iov` into `fd`, continuing after partial writes
+ *
+ * Adjacent lines are handed over as one vector, so the vectors can add up
+ * to more than `writev()` accepts at once; they are then written in parts
+ * of at most `SSIZE_MAX` bytes.
+ *
+ * \returns errno	as set by `writev()` if it fails
+ * \returns 0		if everything went OK
+ */
+static int elastic_print_writev(int fd, struct iovec *iov, int iovcnt)
 {
-	size_t i;
+	ssize_t written;
+	size_t total;
+	int count;
 
-	if (eprint == NULL) {
-		return;
-	}
+	while (iovcnt > 0) {
+		total = iov[0].iov_len;
+		for (count = 1; (count < iovcnt) &&
+				(iov[count].iov_len <= (SSIZE_MAX - total));
+		     count++) {
+			total += iov[count].iov_len;
+		}
 
-	if (eprint->column_widths != NULL) {
-		free(eprint->column_widths);
-		eprint->column_widths = NULL;
+		written = writev(fd, iov, count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return errno;
+		}
+
+		while ((iovcnt > 0) && ((size_t) written >= iov->iov_len)) {
+			written -= (ssize_t) iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + written;
+			iov->iov_len -= (size_t) written;
+		}
 	}
 
-	if (eprint->lines != NULL) {
-		for (i = 0; i < eprint->lines_count; i++) {
-			if (eprint->lines[i] != NULL) {
-				free(eprint->lines[i]);
-				eprint->lines[i] = NULL;
+	return 0;
+}
+
+/** appends all stored lines not spilled yet to the spill-file
+ *
+ * Lines that follow each other in the storage are written with one vector.
+ * Afterwards the spilled lines don't point anywhere until the file is
+ * mapped, and all storage-chunks but the newest one are reused; the newest
+ * one can still hold text that is being added, see
+ * `elastic_print_add_vprintf()`.
+ *
+ * \returns EFBIG	if the file would get bigger than a `size_t`
+ * \returns errno	as reported by `writev()`, nothing is spilled then
+ * \returns 0		if everything went OK
+ */
+static int elastic_print_spill_flush(struct elastic_print *eprint)
+{
+	int rc;
+
+	struct elastic_print_spill *spill = eprint->spill;
+	struct iovec iov[ELASTIC_PRINT_IOVECS];
+	int iovcnt = 0;
+
+	size_t line, length, size = spill->size;
+	const char *text;
+
+	for (line = spill->lines; line < eprint->lines_count; line++) {
+		text = eprint->lines[line];
+		length = eprint->lines_length[line] + 1;
+
+		if (length > (SIZE_MAX - size)) {
+			rc = EFBIG;
+			goto err_rewind;
+		}
+		size += length;
+
+		if ((iovcnt > 0) &&
+		    (((const char *) iov[iovcnt - 1].iov_base +
+		      iov[iovcnt - 1].iov_len) == text)) {
+			iov[iovcnt - 1].iov_len += length;
+			continue;
+		}
+
+		if (iovcnt == ELASTIC_PRINT_IOVECS) {
+			rc = elastic_print_writev(spill->fd, iov, iovcnt);
+			if (rc != 0) {
+				goto err_rewind;
 			}
+			iovcnt = 0;
 		}
 
-		free(eprint->lines);
-		eprint->lines = NULL;
+		iov[iovcnt].iov_base = (void *) text;
+		iov[iovcnt].iov_len = length;
+		iovcnt += 1;
 	}
 
-	memset(eprint, 0, sizeof(*eprint));
+	rc = elastic_print_writev(spill->fd, iov, iovcnt);
+	if (rc != 0) {
+		goto err_rewind;
+	}
+
+	for (line = spill->lines; line < eprint->lines_count; line++) {
+		eprint->lines[line] = NULL;
+	}
+
+	eprint->stats.bytes_spilled += size - spill->size;
+	spill->lines = eprint->lines_count;
+	spill->size = size;
+	spill->pending = 0;
+
+	elastic_print_chunks_recycle(eprint);
+
+	return 0;
+err_rewind:
+	/* whatever made it into the file is overwritten by the next try */
+	lseek(spill->fd, (off_t) spill->size, SEEK_SET);
+	return rc;
 }
 
-int elastic_print_add_line(struct elastic_print *eprint, char *line,
-			   size_t length)
+/** maps the spill-file and points the spilled lines into it, before they
+ * are rendered
+ *
+ * The mapping is only renewed if lines were spilled since the last time.
+ * The file is read sequentially by every render, its pages can be dropped
+ * from memory again at any time.
+ *
+ * \returns errno	as reported by `mmap()`
+ * \returns 0		if everything went OK
+ */
+static int elastic_print_spill_map(struct elastic_print *eprint)
 {
-	int rc = 0;
+	struct elastic_print_spill *spill = eprint->spill;
+	char *map;
+	size_t line, offset = 0;
 
-	char **last_line, *cur, c;
-	size_t column_i, column_len, i;
+	if ((spill == NULL) || (spill->size == spill->mapped)) {
+		return 0;
+	}
 
-	if (eprint == NULL) {
-		rc = EINVAL;
-		goto err;
+	map = mmap(NULL, spill->size, PROT_READ, MAP_PRIVATE, spill->fd, 0);
+	if (map == MAP_FAILED) {
+		return errno;
 	}
-	if ((line == NULL) || (length == 0) || (line[0] == '\0')) {
-		goto out;
+	posix_madvise(map, spill->size, POSIX_MADV_SEQUENTIAL);
+
+	if (spill->map != NULL) {
+		munmap(spill->map, spill->mapped);
 	}
+	spill->map = map;
+	spill->mapped = spill->size;
 
-	eprint->lines_count += 1;
-	eprint->lines = realloc(eprint->lines,
-				(eprint->lines_count) * sizeof(*eprint->lines));
-	if (eprint->lines == NULL) {
-		rc = ENOMEM;
-		goto err_reduce_line;
+	for (line = 0; line < spill->lines; line++) {
+		eprint->lines[line] = &map[offset];
+		offset += eprint->lines_length[line] + 1;
 	}
+	assert(offset == spill->size);
 
-	last_line = &(eprint->lines[eprint->lines_count - 1]);
-	*last_line = malloc((length + 3) * sizeof(**last_line));
-	if (*last_line == NULL) {
-		rc = ENOMEM;
-		goto err_reduce_line;
+	return 0;
+}
+
+int elastic_print_fdput(struct elastic_print *eprint, int fd)
+{
+	int rc;
+
+	struct iovec iov[ELASTIC_PRINT_IOVECS];
+	int iovcnt = 0;
+
+	size_t line, next, column, cell, pad;
+	size_t *cursor;
+	const char *cur, *end;
+	uint64_t start;
+
+	if ((eprint == NULL) || (fd < 0)) {
+		rc = EINVAL;
+		goto err;
 	}
-	/* safety in case someone forgets to account for the 0-terminator in
-	 * `line` and to add a ending '\t' to the line. */
-	(*last_line)[length] = (*last_line)[length + 1] =
-	    (*last_line)[length + 2] = '\0';
 
-	strncpy(*last_line, line, length);
+	start = elastic_print_clock();
 
-	column_i = 0;
-	column_len = 0;
-	i = 0;
+	rc = elastic_print_gather(eprint);
+	if (rc == 0) {
+		rc = elastic_print_spill_map(eprint);
+	}
+	if (rc != 0) {
+		goto err;
+	}
 
-	cur = *last_line;
+	rc = elastic_print_cursor_alloc(eprint, &cursor);
+	if (rc != 0) {
+		goto err;
+	}
 
-#define __set_max_cw(i, len)                                                   \
+#define __add_iov(base, len)                                                   \
 	{                                                                      \
-		if ((i) < eprint->columns) {                                   \
-			if (eprint->column_widths[(i)] < (len)) {              \
-				eprint->column_widths[(i)] = (len);            \
+		if (iovcnt == ELASTIC_PRINT_IOVECS) {                          \
+			rc = elastic_print_writev(fd, iov, iovcnt);            \
+			if (rc != 0) {                                         \
+				goto err_count;                                \
 			}                                                      \
+			iovcnt = 0;                                            \
 		}                                                              \
+                                                                               \
+		iov[iovcnt].iov_base = (void *) (base);                        \
+		iov[iovcnt].iov_len = (len);                                   \
+		iovcnt += 1;                                                   \
 	}
 
-	while ((i < length) && (*cur != '\0')) {
-		switch (*cur) {
-		case '\n':
-			c = '\r';
-
-			goto newline;
-			break;
-		case '\r':
-			c = '\n';
-newline:
-			*cur = '\0';
-
-			if ((i + 1) < length) {
-				cur++;
-				i++;
-
-				if (*cur != c) {
-					cur--;
-					i--;
-				} else {
-					*cur = '\0';
-				}
-			}
+	/* nothing is elastic, the lines are written as they are */
+	for (line = 0; (eprint->columns == 0) && (line < eprint->lines_count);
+	     line = next) {
+		pad = elastic_print_passthrough_run(eprint, line,
+						    eprint->lines_count, &next);
+		if (pad > 0) {
+			__add_iov(eprint->lines[line], pad);
+		}
 
-			__set_max_cw(column_i, column_len);
+		if (eprint->lines_borrowed > 0) {
+			__add_iov(elastic_print_newline, 1);
+		}
+	}
 
-			rc = elastic_print_add_line(eprint, cur + 1,
-						    length - (i + 1));
-			goto err;
+	for (line = 0; (eprint->columns > 0) && (line < eprint->lines_count);
+	     line += 1) {
+		cur = eprint->lines[line];
+		end = cur + eprint->lines_length[line];
+		cell = eprint->lines_cells_first[line];
 
-			break;
-		case '\t':
-			__set_max_cw(column_i, column_len + 1);
+		elastic_print_cursor_step(eprint, cursor, line);
 
-			column_len = 0;
-			column_i += 1;
+		for (column = 0; column < eprint->lines_cells[line];
+		     column += 1, cell += 1) {
+			if (eprint->cells_length[cell] > 0) {
+				__add_iov(cur, eprint->cells_length[cell]);
+			}
 
-			break;
-		default:
-			if (isprint(*cur)) {
-				column_len += 1;
-			} else if ((isspace(*cur) && (!isblank(*cur))) ||
-				   (*cur == 127)) {
-				*cur = ' ';
-				column_len += 1;
+			pad = elastic_print_cursor_width(eprint, cursor,
+							 column) -
+			      eprint->cells_width[cell];
+			while (pad > 0) {
+				__add_iov(elastic_print_spaces,
+					  (pad < sizeof(elastic_print_spaces) - 1) ?
+					      pad :
+					      sizeof(elastic_print_spaces) - 1);
+				pad -= iov[iovcnt - 1].iov_len;
 			}
-			break;
+
+			cur += eprint->cells_length[cell] + 1;
 		}
 
-		i += 1;
-		cur++;
+		if (cur < end) {
+			__add_iov(cur, (size_t) (end - cur));
+		}
+		__add_iov(elastic_print_newline, 1);
 	}
 
-	assert(i <= length);
-
-	if (column_i < eprint->columns) {
-		/* still in a valid column */
-		assert(i < (length + 2));
-		*cur = '\t';
-
-		column_len += 1;
-		__set_max_cw(column_i, column_len);
+#undef __add_iov
 
-		i += 1;
-		cur++;
-		assert(i < (length + 2));
-
-		*cur = '\0';
+	rc = elastic_print_writev(fd, iov, iovcnt);
+	if (rc == 0) {
+		eprint->stats.bytes_rendered += eprint->output_length;
 	}
-
-out:
-	rc = 0;
-	goto err;
-err_reduce_line:
-	eprint->lines_count -= 1;
+err_count:
+	eprint->stats.renders += 1;
+	eprint->stats.render_nsec += elastic_print_clock() - start;
 err:
 	return rc;
 }
 
-int elastic_print_add_string(struct elastic_print *eprint, char *str)
+/** writes all lines stored in streaming mode and releases them
+ *
+ * The lines are only released once they were written, so a failed write
+ * is tried again with the next flush.
+ */
+static int elastic_print_stream_flush(struct elastic_print *eprint)
 {
-	if (str == NULL) {
-		return 0;
+	int rc;
+
+	rc = elastic_print_fdput(eprint, eprint->stream_fd);
+	if (rc != 0) {
+		return rc;
 	}
 
-	return elastic_print_add_line(eprint, str, strlen(str) + 1);
+	elastic_print_clear(eprint);
+
+	return 0;
 }
 
-int elastic_print_add_printf(struct elastic_print *eprint, const char *fmt, ...)
+int elastic_print_stream(struct elastic_print *eprint, int fd)
 {
-#define __startlen	(1 << 8)
-	int rc = 0;
-	char * buffer;
-	size_t buffer_len = __startlen;
-	int written;
-
-	va_list arguments;
+	int rc;
 
-	buffer = calloc(buffer_len + 1, sizeof(* buffer));
-	if (buffer == NULL) {
-		rc = ENOMEM;
-		goto err;
+	if ((eprint == NULL) || (fd < 0) || (eprint->lines_count > 0) ||
+	    (eprint->stream_fd >= 0) || (eprint->histograms != NULL) ||
+	    (eprint->concurrent != NULL) || (eprint->spill != NULL)) {
+		return EINVAL;
 	}
 
-	buffer[buffer_len] = '\0';
+	rc = elastic_print_blocks_enable(eprint);
+	if (rc != 0) {
+		return rc;
+	}
 
-	va_start(arguments, fmt);
+	eprint->stream_fd = fd;
 
-	written = vsnprintf(buffer, buffer_len, fmt, arguments);
-	if (written < 0) {
-		rc = EFAULT;
-		goto err_va_end;
-	} else if ((unsigned int) written >= buffer_len) {
-		buffer_len = (unsigned int) written + 1;
+	return 0;
+}
 
-		buffer = realloc(buffer, (buffer_len + 1) * sizeof(*buffer));
-		if (buffer == NULL) {
-			rc = ENOMEM;
-			goto err_va_end;
-		}
+int elastic_print_stream_finish(struct elastic_print *eprint)
+{
+	int rc = 0;
 
-		buffer[buffer_len] = '\0';
+	if ((eprint == NULL) || (eprint->stream_fd < 0)) {
+		return EINVAL;
+	}
 
-		written = vsnprintf(buffer, buffer_len, fmt, arguments);
-		if ((written < 0) || ((unsigned int) written >= buffer_len)) {
-			rc = EFAULT;
-			goto err_va_end;
+	if (eprint->lines_count > 0) {
+		rc = elastic_print_stream_flush(eprint);
+		if (rc != 0) {
+			/* still streaming, so this can be called again */
+			return rc;
 		}
 	}
 
-	rc = elastic_print_add_string(eprint, buffer);
-	if (rc != 0) {
-		goto err_va_end;
-	}
+	eprint->stream_fd = -1;
 
-/* out: */
-	rc = 0;
-err_va_end:
-	va_end(arguments);
-/* err_free_buffer: */
-	free(buffer);
-err:
 	return rc;
 }
 
-int elastic_print_snput(struct elastic_print *eprint, char *buffer,
-			size_t buffer_len)
+int elastic_print_spill(struct elastic_print *eprint, size_t budget,
+			const char *directory)
 {
 	int rc;
-	size_t line, llength, bleft, written;
-	char *cur_buf;
 
-	if ((eprint == NULL) || (buffer == NULL) || (buffer_len < 1)) {
-		rc = -EINVAL;
+	static const char name[] = "/elastictab-XXXXXX";
+	struct elastic_print_spill *spill;
+	char *path;
+
+	if ((eprint == NULL) || (eprint->lines_count > 0) ||
+	    (eprint->stream_fd >= 0) || (eprint->histograms != NULL) ||
+	    (eprint->concurrent != NULL) || (eprint->spill != NULL)) {
+		rc = EINVAL;
 		goto err;
 	}
 
-	buffer[0] = '\0';
-	buffer[buffer_len - 1] = '\0';
+	if (directory == NULL) {
+		directory = getenv("TMPDIR");
+		if ((directory == NULL) || (directory[0] == '\0')) {
+			directory = "/tmp";
+		}
+	}
 
-	written = 0;
-	cur_buf = &(buffer[0]);
-	bleft = buffer_len;
+	spill = calloc(1, sizeof(*spill));
+	if (spill == NULL) {
+		rc = ENOMEM;
+		goto err;
+	}
+	eprint->stats.allocs += 1;
 
-#define __dec_left(b)                                                          \
-	{                                                                      \
-		if ((b) == 0) {                                                \
-			rc = -EFAULT;                                          \
-			goto err_terminate;                                    \
-		}                                                              \
-                                                                               \
-		(b) -= 1;                                                      \
-		if ((b) <= 1) {                                                \
-			rc = -ENOMEM;                                          \
-			goto err_terminate;                                    \
-		}                                                              \
+	path = malloc(strlen(directory) + sizeof(name));
+	if (path == NULL) {
+		rc = ENOMEM;
+		goto err_free_spill;
 	}
-#define __append_char(buf, c, left, written)                                   \
-	{                                                                      \
-		if ((left) < 2) {                                              \
-			rc = -EFAULT;                                          \
-			goto err_terminate;                                    \
-		}                                                              \
-                                                                               \
-		*(buf) = (c);                                                  \
-		(buf) += 1;                                                    \
-		(written) += 1;                                                \
-		*(buf) = '\0';                                                 \
+	eprint->stats.allocs += 1;
+
+	strcpy(path, directory);
+	strcat(path, name);
+
+	spill->fd = mkstemp(path);
+	if (spill->fd < 0) {
+		rc = errno;
+		goto err_free_path;
 	}
+	/* the file is only reachable by its descriptor from now on */
+	unlink(path);
+	free(path);
 
-	for (line = 0; line < eprint->lines_count; line += 1) {
-		char *cur_line = eprint->lines[line];
-		char *cur_c = cur_line;
-		size_t column = 0;
-		size_t column_s = 0;
+	spill->budget = (budget > ELASTIC_PRINT_CHUNK_SIZE) ?
+				budget :
+				ELASTIC_PRINT_CHUNK_SIZE;
+	eprint->spill = spill;
 
-		llength = strlen(cur_line);
-		if ((llength + 2) > bleft) {
-			rc = -ENOMEM;
-			goto err_terminate;
-		}
+	return 0;
+err_free_path:
+	free(path);
+err_free_spill:
+	free(spill);
+err:
+	return rc;
+}
 
-		while (*cur_c != '\0') {
-			if (bleft <= 1) {
-				rc = -ENOMEM;
-				goto err_terminate;
-			}
+int elastic_print_reset(struct elastic_print *eprint)
+{
+	struct elastic_print_shard *shard;
+	size_t i;
 
-			switch (*cur_c) {
-			case '\t':
-				if (column >= eprint->columns) {
-					goto append_normal;
-				}
+	if ((eprint == NULL) || (eprint->stream_fd >= 0)) {
+		return EINVAL;
+	}
 
-				do {
-					__append_char(cur_buf, ' ', bleft,
-						      written);
-					__dec_left(bleft);
+	if (eprint->spill != NULL) {
+		/* the mapping can't outlive the end of the file */
+		if (eprint->spill->map != NULL) {
+			munmap(eprint->spill->map, eprint->spill->mapped);
+			eprint->spill->map = NULL;
+			eprint->spill->mapped = 0;
+		}
 
-					column_s++;
-				} while (column_s <
-					 eprint->column_widths[column]);
+		if ((ftruncate(eprint->spill->fd, 0) != 0) ||
+		    (lseek(eprint->spill->fd, 0, SEEK_SET) != 0)) {
+			return errno;
+		}
 
-				column += 1;
-				column_s = 0;
+		eprint->spill->lines = 0;
+		eprint->spill->size = 0;
+		eprint->spill->pending = 0;
+	}
 
-				break;
-			default:
-append_normal:
-				__append_char(cur_buf, *cur_c, bleft, written);
-				__dec_left(bleft);
-
-				if (isprint(*cur_c) || isblank(*cur_c)) {
-					column_s++;
-					assert((!(column < eprint->columns)) ||
-					       (column_s <
-						eprint->column_widths[column]));
-				}
-				break;
-			}
+	elastic_print_clear(eprint);
+	elastic_print_mappings_release(eprint);
 
-			cur_c++;
+	if (eprint->concurrent != NULL) {
+		for (shard = eprint->concurrent->shards; shard != NULL;
+		     shard = shard->next) {
+			elastic_print_clear(&shard->eprint);
+			shard->runs_count = 0;
+			shard->runs_merged = 0;
 		}
 
-		__append_char(cur_buf, '\n', bleft, written);
-		__dec_left(bleft);
+		for (i = 0; i < eprint->concurrent->columns; i++) {
+			eprint->concurrent->widths[i] =
+			    eprint->column_widths_min;
+		}
 	}
 
-	/* out: */
-	rc = written;
-err_terminate:
-	buffer[buffer_len - 1] = '\0';
-err:
-	return rc;
+	return 0;
 }
 
-int elastic_print_fput(struct elastic_print * eprint, FILE * stream)
+void elastic_print_get_stats(const struct elastic_print *eprint,
+			     struct elastic_print_stats *stats)
 {
-	const size_t START_LENGTH = ((1 << 8) + 1);
-	const float INCREMENT = 1.5;
+	const struct elastic_print_shard *shard;
 
-	int rc;
+	if ((eprint == NULL) || (stats == NULL)) {
+		return;
+	}
+
+	*stats = eprint->stats;
+
+	if (eprint->concurrent == NULL) {
+		return;
+	}
 
-	char * buffer = NULL;
-	size_t buffer_len = START_LENGTH;
+	/* the shards are not merged yet */
+	for (shard = eprint->concurrent->shards; shard != NULL;
+	     shard = shard->next) {
+		stats->lines_added += shard->eprint.stats.lines_added;
+		stats->bytes_added += shard->eprint.stats.bytes_added;
+		stats->bytes_stored += shard->eprint.stats.bytes_stored;
+		stats->bytes_borrowed += shard->eprint.stats.bytes_borrowed;
+		stats->bytes_storage += shard->eprint.stats.bytes_storage;
+		stats->allocs += shard->eprint.stats.allocs;
+		stats->reallocs += shard->eprint.stats.reallocs;
+		stats->add_nsec += shard->eprint.stats.add_nsec;
+	}
+}
 
-	assert((START_LENGTH > 0) && (INCREMENT >= 1));
+int elastic_print_stats_fput(const struct elastic_print *eprint,
+			     FILE *stream)
+{
+	struct elastic_print_stats counters, *stats = &counters;
+	int written;
 
 	if ((eprint == NULL) || (stream == NULL)) {
-		rc = EINVAL;
-		goto err;
+		return EINVAL;
 	}
 
-	do {
-		buffer = realloc(buffer, (buffer_len + 1) * sizeof(*buffer));
-		if (buffer == NULL) {
-			rc = ENOMEM;
-			goto err;
-		}
-		buffer[buffer_len] = '\0';
+	elastic_print_get_stats(eprint, stats);
 
-		rc = elastic_print_snput(eprint, buffer, buffer_len);
-		if ((rc < 0) && (rc != -ENOMEM)) {
-			rc = -rc ;
-			goto err_free_buffer;
-		} else if (rc == -ENOMEM) {
-			buffer_len =
-			    (((size_t)(buffer_len * INCREMENT)) > buffer_len ?
-				 buffer_len * INCREMENT :
-				 buffer_len + 1);
-		}
-	} while (rc == -ENOMEM);
-
-	/* either nonnegative or EOF on error */
-	rc = fputs(buffer, stream);
-	if (rc >= 0) {
-		/* success */
-		rc = 0;
-	} else if (rc != EOF) {
-		/* invalid according to fputs(3) */
-		assert(0);
-		rc = EOF;
+	written = fprintf(stream,
+			  "elastictab %p: %zu lines, %zu bytes added in %.3f ms; "
+			  "%zu bytes stored in %zu bytes of storage, "
+			  "%zu bytes borrowed, %zu bytes spilled; "
+			  "%zu allocs, %zu reallocs; "
+			  "%zu renders, %zu bytes rendered in %.3f ms\n",
+			  (const void *) eprint, stats->lines_added,
+			  stats->bytes_added, (double) stats->add_nsec / 1e6,
+			  stats->bytes_stored, stats->bytes_storage,
+			  stats->bytes_borrowed, stats->bytes_spilled,
+			  stats->allocs, stats->reallocs, stats->renders,
+			  stats->bytes_rendered,
+			  (double) stats->render_nsec / 1e6);
+	if (written < 0) {
+		return EOF;
 	}
 
-err_free_buffer:
-	free(buffer);
-err:
-	return rc;
+	return 0;
 }
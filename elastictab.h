@@ -24,6 +24,7 @@
 #include "errno.h"
 #include "stdarg.h"
 #include "stdint.h"
+#include "sys/types.h"
 
 /*
  * Very simple implementation of elastic tabstops in C. More about the theory
@@ -31,11 +32,25 @@
  * elastictabstops).
  *
  * This implementation is useful for stuff like printing help-pages or simple
- * tables. Not so much for interactive environments, as it currently is not
- * dynamic. A instance is initializes to consider a certain amount of columns
- * to be elastic and this number can not be changed later. You would have to
- * create multiple instances to change to columns or support more than one
- * column-set (lines with different lengths of the elastic columns).
+ * tables. A instance is initialized to consider a certain amount of columns
+ * to be elastic. Created with `ELASTIC_PRINT_DYNAMIC`, it instead starts
+ * without columns and gains one whenever a line has more elastic cells than
+ * seen so far, up to `columns_max` (the amount given at creation, 0 for no
+ * limit). Created with `ELASTIC_PRINT_UPDATE`, stored lines can be replaced
+ * with `elastic_print_update_line()` or dropped with
+ * `elastic_print_remove_line()` and the columns follow the new content, so
+ * the same instance can be printed again and again, e.g. for a live
+ * dashboard.
+ *
+ * By default every column is as wide as its widest cell in the whole
+ * instance; to support more than one column-set (lines with different lengths
+ * of the elastic columns) the instance can be created with
+ * `ELASTIC_PRINT_BLOCKS`, so each run of adjacent lines sharing a column gets
+ * its own width.
+ *
+ * Text is expected to be UTF-8; the width of a cell is the number of terminal
+ * columns it occupies (wide East Asian characters count twice, combining
+ * marks not at all), bytes that are not valid UTF-8 count once each.
  *
  * A simple example could look like this:
  *
@@ -63,6 +78,43 @@
  * >                      ccccccc
  */
 
+/** counters an elastictab instance keeps about its own work
+ *
+ * All counters start at 0 with `elastic_print_create()` and only ever grow.
+ * The timings are taken with `CLOCK_MONOTONIC`.
+ */
+struct elastic_print_stats
+{
+	/** number of lines added */
+	size_t		lines_added;
+	/** number of bytes handed to the `add_*()`-calls, after the lines
+	 * were cut at their first 0-character */
+	size_t		bytes_added;
+	/** number of bytes used to store the added lines (including their
+	 * newlines) */
+	size_t		bytes_stored;
+	/** number of bytes allocated for the storage of lines */
+	size_t		bytes_storage;
+	/** number of bytes of lines that were only referenced, see
+	 * `elastic_print_add_borrowed()` */
+	size_t		bytes_borrowed;
+	/** number of bytes of stored lines written to the spill-file, see
+	 * `elastic_print_spill()` */
+	size_t		bytes_spilled;
+	/** number of `malloc()`/`calloc()`-calls made by the instance */
+	size_t		allocs;
+	/** number of `realloc()`-calls made by the instance */
+	size_t		reallocs;
+	/** number of renders, one for each `*put()`-call */
+	size_t		renders;
+	/** number of bytes of output rendered */
+	size_t		bytes_rendered;
+	/** nanoseconds spent in the `add_*()`-calls */
+	uint64_t	add_nsec;
+	/** nanoseconds spent rendering */
+	uint64_t	render_nsec;
+};
+
 /** represents one elastictab instance
  *
  * Initialised with `elastic_print_create()` it can be populated with
@@ -85,20 +137,144 @@ struct elastic_print
 	 * elastic.
 	 *
 	 * In case columns is 0, there will be no column-processing done.
+	 *
+	 * With `ELASTIC_PRINT_DYNAMIC` this is the number of columns found so
+	 * far, and grows up to `columns_max` while lines are added.
 	 */
 	size_t		columns;
+	/** maximum number of columns, same as `columns` unless
+	 * `ELASTIC_PRINT_DYNAMIC` is used
+	 */
+	size_t		columns_max;
+	/** number of elements allocated for the per-column arrays */
+	size_t		columns_size;
 
-	/** added/processed lines in this instance */
-	char **		lines;
+	/** added/processed lines in this instance
+	 *
+	 * The strings themselves are stored in `chunks`, this is only the
+	 * index into them. Each stored line is followed by a newline (they
+	 * are not 0-terminated). Lines added with
+	 * `elastic_print_add_borrowed()` point into the memory of the caller
+	 * instead.
+	 */
+	const char **	lines;
 	/** count of those `lines` */
 	size_t		lines_count;
+	/** number of `lines` that point into the memory of the caller */
+	size_t		lines_borrowed;
+	/** number of slots allocated for `lines` (>= `lines_count`) */
+	size_t		lines_size;
+	/** length of each of the `lines` (without the newline) */
+	size_t *	lines_length;
+	/** number of elastic cells in each of the `lines` */
+	size_t *	lines_cells;
+	/** index of the first elastic cell of each of the `lines` in `cells_*` */
+	size_t *	lines_cells_first;
+	/** storage-chunk each of the `lines` is stored in, NULL for those that
+	 * point into the memory of the caller; only kept with
+	 * `ELASTIC_PRINT_UPDATE`, NULL otherwise
+	 */
+	struct elastic_print_chunk **	lines_chunk;
+
+	/** byte-length of each elastic cell (without its finishing tab)
+	 *
+	 * The cells of all lines are stored one after another, and are found
+	 * while the lines are added, so printing them doesn't need to look for
+	 * tabs or measure anything again. The cells of a line are followed by
+	 * the text behind its last elastic tab, that is printed as it is.
+	 */
+	size_t *	cells_length;
+	/** printed width of each elastic cell */
+	size_t *	cells_width;
+	/** number of cells in `cells_length` and `cells_width` */
+	size_t		cells_count;
+	/** number of those cells that belonged to lines, which were replaced
+	 * or removed since, see `ELASTIC_PRINT_UPDATE`
+	 */
+	size_t		cells_dead;
+	/** number of elements allocated for `cells_length` and `cells_width` */
+	size_t		cells_size;
+
+	/** list of storage-chunks holding the text of all `lines`
+	 *
+	 * New lines are carved out of the newest chunk, so that adding a line
+	 * usually doesn't need a allocation on its own. All chunks are freed
+	 * at once in `elastic_print_destory()`.
+	 */
+	struct elastic_print_chunk *	chunks;
+	/** storage-chunks that held lines already dropped again, they are
+	 * used before any new chunk is allocated
+	 */
+	struct elastic_print_chunk *	chunks_spare;
 
 	/** array of `columns` elements that safe the elastic width of each
-	 * column
+	 * column (the widest of all its blocks, when using
+	 * `ELASTIC_PRINT_BLOCKS`)
 	 */
 	size_t *	column_widths;
 	/** minimum width of each column (> 0) */
 	size_t		column_widths_min;
+
+
+	/** array of `columns` elements that count the elastic cells in each
+	 * column (only those in the newest block of each column, when using
+	 * `ELASTIC_PRINT_BLOCKS`)
+	 */
+	size_t *	column_cells;
+	/** number of characters the output of this instance has (excluding
+	 * the 0-terminator), kept up to date by every `add_*()`-call
+	 */
+	size_t		output_length;
+	/** set once `output_length` doesn't fit a `size_t` anymore; the
+	 * output can then only be written into streams, see
+	 * `elastic_print_measure()`
+	 */
+	int		output_overflow;
+
+	/** array of `columns` elements with the widths of the column blocks
+	 * in each column, NULL if `ELASTIC_PRINT_BLOCKS` is not used
+	 */
+	struct elastic_print_blocks *	blocks;
+
+	/** array of `columns` elements with a histogram of the widths wanted
+	 * by the cells of each column, NULL if `ELASTIC_PRINT_UPDATE` is not
+	 * used
+	 */
+	struct elastic_print_histogram *	histograms;
+
+	/** file-descriptor closed blocks are written to in streaming mode,
+	 * -1 if the instance is not in streaming mode
+	 */
+	int		stream_fd;
+
+	/** block the output of `elastic_print_sinkput()` is put together in,
+	 * kept for the next call
+	 */
+	char *		render_block;
+	/** cursors of the last render with column blocks, kept for the next
+	 * one
+	 */
+	size_t *	render_cursor;
+	/** number of elements allocated for `render_cursor` */
+	size_t		render_cursor_size;
+
+	/** the lines added by each thread and the widths they published,
+	 * NULL if `ELASTIC_PRINT_CONCURRENT` is not used
+	 */
+	struct elastic_print_concurrent *	concurrent;
+
+	/** files mapped by `elastic_print_add_fd()`, that the lines read
+	 * from them are borrowed from
+	 */
+	struct elastic_print_mapping *	mappings;
+
+	/** the file stored lines are moved to, NULL if the instance is not
+	 * in spill mode
+	 */
+	struct elastic_print_spill *	spill;
+
+	/** counters of this instance, see `elastic_print_get_stats()` */
+	struct elastic_print_stats	stats;
 };
 
 /** initializes a `struct elastic_print`
@@ -115,9 +291,77 @@ struct elastic_print
 int elastic_print_create(struct elastic_print *eprint, size_t columns,
 			 size_t column_widths_min);
 
+/** flag for `elastic_print_create_flags()`: use column blocks
+ *
+ * Without this flag, each column is as wide as its widest cell in the whole
+ * instance. With it, the widths are scoped to column blocks, as in elastic
+ * tabstops: a column block is a run of adjacent lines that all have a elastic
+ * cell in this column, each block gets the width of its widest cell.
+ *
+ * With column blocks only cells finished by a tab are elastic; the text
+ * behind the last tab of a line is neither padded nor accounted for in the
+ * column widths.
+ */
+#define ELASTIC_PRINT_BLOCKS	(1u << 0)
+
+/** flag for `elastic_print_create_flags()`: find the columns while adding
+ *
+ * The instance starts without any columns and the per-column arrays grow
+ * whenever a line with more elastic cells than seen so far is added. The
+ * `columns` given at creation is the maximum number of columns then, or no
+ * maximum at all if it is 0.
+ */
+#define ELASTIC_PRINT_DYNAMIC	(1u << 1)
+
+/** flag for `elastic_print_create_flags()`: allow lines to be changed
+ *
+ * Each column keeps a histogram of the widths of its cells, so that
+ * `elastic_print_update_line()` and `elastic_print_remove_line()` can find
+ * the new width of a column without looking at the other lines again. This
+ * costs memory in the order of the widest cell of each column.
+ *
+ * Can't be combined with `ELASTIC_PRINT_BLOCKS`, or streaming mode.
+ */
+#define ELASTIC_PRINT_UPDATE	(1u << 2)
+
+/** flag for `elastic_print_create_flags()`: allow adding from many threads
+ *
+ * `elastic_print_add_line()`, `elastic_print_add_string()`,
+ * `elastic_print_add_printf()` and `elastic_print_add_borrowed()` can be
+ * called from any number of threads at the same time. Each thread adds to
+ * a shard of its own, and only publishes the widths of its columns to the
+ * instance, with atomic operations. Every call takes a number from a global
+ * sequence, the lines of all shards are merged in the order of those
+ * numbers (and so in the order the calls started) once the instance is
+ * printed.
+ *
+ * All other functions (`*put()`, `elastic_print_measure()`,
+ * `elastic_print_reset()`, ...) MUST not run at the same time as any
+ * `add_*()`-call. `elastic_print_add_bulk()` and `elastic_print_add_fd()` add
+ * their input with a single thread in this mode.
+ *
+ * Can't be combined with `ELASTIC_PRINT_BLOCKS`, `ELASTIC_PRINT_UPDATE`, or
+ * streaming mode; combined with `ELASTIC_PRINT_DYNAMIC` a maximum number of
+ * columns has to be given.
+ */
+#define ELASTIC_PRINT_CONCURRENT	(1u << 3)
+
+/** same as `elastic_print_create()`, but with additional flags
+ *
+ * \para flags		a combination of `ELASTIC_PRINT_*`-flags
+ *
+ * Everything else is the same as with `elastic_print_create()`.
+ */
+int elastic_print_create_flags(struct elastic_print *eprint, size_t columns,
+			       size_t column_widths_min, unsigned int flags);
+
 /** destroys a elastictab-instance and frees all memory
  *
  * \para eprint	instance that shall be destroyed
+ *
+ * If the environment-variable `ELASTICTAB_STATS` is set (and not empty), the
+ * statistics of the instance are printed to stderr first, see
+ * `elastic_print_stats_fput()`.
  */
 void elastic_print_destory(struct elastic_print *eprint);
 
@@ -152,6 +396,67 @@ int elastic_print_add_line(struct elastic_print *eprint, char *line,
  */
 int elastic_print_add_string(struct elastic_print *eprint, char *str);
 
+/** same as `elastic_print_add_line()`, but without copying the lines
+ *
+ * \para text		lines that shall be added, MUST stay unchanged and
+ *			valid until `eprint` is destroyed
+ * \para length		length in characters of `text`
+ *
+ * Only references into `text` are stored for each line (with the lengths
+ * and widths of its cells), so adding text that is already kept in memory
+ * (e.g. a mapped file) doesn't need the memory twice. `text` itself is never
+ * changed. Lines with control-characters that are replaced by spaces in the
+ * output are still copied.
+ *
+ * Everything else is the same as with `elastic_print_add_line()`.
+ */
+int elastic_print_add_borrowed(struct elastic_print *eprint, const char *text,
+			       size_t length);
+
+/** same as `elastic_print_add_line()`, but measures large inputs with
+ * multiple threads
+ *
+ * \para eprint		current elastictab instance
+ * \para buffer		the lines that shall be added
+ * \para length		length of `buffer` in characters
+ * \para threads	maximum number of threads to use, or 0 to use one per
+ *			online CPU
+ *
+ * \returns EINVAL	in case a parameter is considered wrong
+ * \returns ENOMEM	if not enough memory could be allocated
+ * \returns errno	as reported by `pthread_create()`
+ * \returns 0		in case everything went OK
+ *
+ * The buffer is split into parts on line-breaks, and each part is measured
+ * into a private instance by its own thread. Afterwards the parts are
+ * merged into `eprint` in order, so the result is the same as with a
+ * single call to `elastic_print_add_line()`. Small inputs and instances in
+ * streaming mode are processed by the calling thread alone.
+ *
+ * In case of an error, lines of the parts in front of the failing one can
+ * already be added.
+ */
+int elastic_print_add_bulk(struct elastic_print *eprint, const char *buffer,
+			   size_t length, unsigned int threads);
+
+/** same as `elastic_print_add_bulk()` with everything that can be read from
+ * `fd`
+ *
+ * \para fd		file-descriptor to read until its end
+ *
+ * \returns errno	as reported by `read()`
+ * \returns `elastic_print_add_bulk()`
+ *
+ * Regular files are mapped into memory instead of read, and their lines are
+ * borrowed from the mapping (see `elastic_print_add_borrowed()`) instead of
+ * copied. The mapping is kept until the instance is reset or destroyed; the
+ * file MUST not be truncated in the meantime. In spill mode the lines are
+ * copied, and everything that is not a regular file is added in pieces of
+ * complete lines while it is read.
+ */
+int elastic_print_add_fd(struct elastic_print *eprint, int fd,
+			 unsigned int threads);
+
 /** adds/processes a printf-like formated line to the given elastictab-instance
  *
  * \para eprint		current elastictab instance
@@ -166,9 +471,51 @@ int elastic_print_add_string(struct elastic_print *eprint, char *str);
  * \returns 0		in case everything went OK
  *
  * For the syntax/semantics of `fmt` please see the printf-manpage (printf(3))
+ *
+ * The text is formatted right into the line storage of the instance, so no
+ * temporary buffer is needed. Only if it doesn't fit into the space left
+ * there, it is formatted a second time into a new storage-chunk.
  */
 int elastic_print_add_printf(struct elastic_print *eprint, const char *fmt, ...);
 
+/** replaces a stored line of the given elastictab-instance
+ *
+ * \para eprint		current elastictab instance, created with
+ *			`ELASTIC_PRINT_UPDATE`
+ * \para line		index of the line that shall be replaced
+ * \para text		the new content of the line
+ * \para length		length of `text`, it ends early at a '\0'
+ *
+ * \returns EINVAL	in case a parameter is considered wrong, or `text`
+ *			contains more than one line
+ * \returns ENOMEM	if not enough memory could be allocated
+ * \returns 0		in case everything went OK, the instance is unchanged
+ *			otherwise
+ *
+ * The line is handled as if it was added by `elastic_print_add_line()` with
+ * the same text, it can end with a line-break. The widths of the columns
+ * are updated to the new content of all lines.
+ *
+ * The new text is put where the replaced one was stored, if it fits there.
+ * Otherwise the storage of the replaced text is reused once more than half
+ * of its storage-chunk (or of the cell index) is no longer used, the same
+ * goes for removed lines.
+ */
+int elastic_print_update_line(struct elastic_print *eprint, size_t line,
+			      const char *text, size_t length);
+
+/** removes a stored line from the given elastictab-instance
+ *
+ * \para eprint		current elastictab instance, created with
+ *			`ELASTIC_PRINT_UPDATE`
+ * \para line		index of the line that shall be removed, the lines
+ *			behind it move up by one
+ *
+ * \returns EINVAL	in case a parameter is considered wrong
+ * \returns 0		in case everything went OK
+ */
+int elastic_print_remove_line(struct elastic_print *eprint, size_t line);
+
 /** prints the given elastictab-instance into the given buffer (0-terminated)
  *
  * \para eprint		current elastictab instance
@@ -181,6 +528,8 @@ int elastic_print_add_printf(struct elastic_print *eprint, const char *fmt, ...)
  *			-manipulation, etc.)
  * \returns -ENOMEM	if the buffer is too small to hold everything including
  *			the 0-terminator
+ * \returns -EOVERFLOW	if the output is longer than `INT_MAX`, see
+ *			`elastic_print_snput_ssize()`
  * \returns >= 0	in case everything went OK, it returns ne number of
  *			written characters (excluding the 0-terminator)
  *
@@ -193,6 +542,54 @@ int elastic_print_add_printf(struct elastic_print *eprint, const char *fmt, ...)
 int elastic_print_snput(struct elastic_print *eprint, char *buffer,
 			size_t buffer_len);
 
+/** same as `elastic_print_snput()`, but returns the length as `ssize_t`
+ *
+ * Everything else is the same as with `elastic_print_snput()`. The length
+ * of the output is not limited to `INT_MAX` here; `elastic_print_snput()`
+ * returns -EOVERFLOW instead, if the output was rendered completely but its
+ * length doesn't fit into its return value.
+ */
+ssize_t elastic_print_snput_ssize(struct elastic_print *eprint, char *buffer,
+				  size_t buffer_len);
+
+/** same as `elastic_print_snput()`, but renders with multiple threads
+ *
+ * \para threads	maximum number of threads to use, or 0 to use one per
+ *			online CPU
+ *
+ * Everything else is the same as with `elastic_print_snput()`.
+ *
+ * The lines are split into one range per thread. Each range is measured by
+ * its thread first, so the offset of each range in `buffer` is known, and
+ * then rendered right into its place. Small outputs, and buffers that are
+ * too small for the whole output, are rendered by the calling thread alone.
+ */
+int elastic_print_snput_threads(struct elastic_print *eprint, char *buffer,
+				size_t buffer_len, unsigned int threads);
+
+/** same as `elastic_print_snput_threads()`, but returns the length as
+ * `ssize_t`, see `elastic_print_snput_ssize()`
+ */
+ssize_t elastic_print_snput_threads_ssize(struct elastic_print *eprint,
+					  char *buffer, size_t buffer_len,
+					  unsigned int threads);
+
+/** returns the exact length of the output of the given elastictab-instance
+ *
+ * \para eprint		current elastictab instance
+ *
+ * \returns the number of characters `elastic_print_snput()` would write
+ *		(excluding the 0-terminator), a buffer of this size + 1 is
+ *		always big enough
+ * \returns SIZE_MAX	if the output is too long for a `size_t`; it can
+ *			still be written with `elastic_print_fput()`,
+ *			`elastic_print_fdput()` or `elastic_print_sinkput()`
+ *
+ * The length is tracked while the lines are added, so this doesn't need to
+ * look at any of the lines again.
+ */
+size_t elastic_print_measure(const struct elastic_print *eprint);
+
 /** prints the given elastictab-instance into the given stream
  *
  * \para eprint         current elastictab instance
@@ -201,13 +598,180 @@ int elastic_print_snput(struct elastic_print *eprint, char *buffer,
  * \returns -`elastic_print_snput()`
  *			error-values that are reported by `elastic_print_snput()`
  *			are returned as their inverse (-ENOMEM -> ENOMEM)
- * \returns EOF		in case the subsequent `fputs` fails to print everything
+ * \returns EOF		in case the subsequent `fwrite` fails to print everything
  *			into the stream
  * \returns 0		in case everything went OK
  *
  * The lines will be processed in the same way as if you would call
- * `elastic_print_snput()`.
+ * `elastic_print_snput()`. The output is written in blocks, see
+ * `elastic_print_sinkput()`.
  */
 int elastic_print_fput(struct elastic_print *eprint, FILE *stream);
 
+/** prints the given elastictab-instance into a sink-callback
+ *
+ * \para eprint		current elastictab instance
+ * \para sink		callback every block of output is handed to, in
+ *			order; it returns 0 if it took all of the block, or a
+ *			error-value that stops the output
+ * \para ctx		pointer that is handed to each call of `sink`
+ *
+ * \returns EINVAL	in case a parameter is considered wrong
+ * \returns ENOMEM	if the block could not be allocated
+ * \returns `sink`	the first non-0 value returned by `sink`, the output is
+ *			incomplete in that case
+ * \returns 0		in case everything went OK
+ *
+ * The lines will be processed in the same way as if you would call
+ * `elastic_print_snput()`, but the output is put together in one block of
+ * fixed size (64 KiB) at a time, which is handed to `sink` once it is full.
+ * Only the last block can be shorter. `sink` is not called at all for
+ * instances without output.
+ */
+int elastic_print_sinkput(struct elastic_print *eprint,
+			  int (*sink)(void *ctx, const char *data,
+				      size_t length),
+			  void *ctx);
+
+/** same as `elastic_print_fput()`, but renders with multiple threads
+ *
+ * \para threads	maximum number of threads to use, or 0 to use one per
+ *			online CPU, see `elastic_print_snput_threads()`
+ */
+int elastic_print_fput_threads(struct elastic_print *eprint, FILE *stream,
+			       unsigned int threads);
+
+/** prints the given elastictab-instance into the given file-descriptor
+ *
+ * \para eprint		current elastictab instance
+ * \para fd		the target file-descriptor that shall be used
+ *
+ * \returns EINVAL	in case a parameter is considered wrong
+ * \returns errno	as reported by `writev()` in case writing fails, the
+ *			output might be incomplete in that case
+ * \returns 0		in case everything went OK
+ *
+ * The lines will be processed in the same way as if you would call
+ * `elastic_print_snput()`, but the output is never put together in one
+ * buffer. Instead it is handed to `writev()` in batches of pieces, that point
+ * directly into the stored lines, or into a static run of spaces for the
+ * padding.
+ */
+int elastic_print_fdput(struct elastic_print *eprint, int fd);
+
+/** puts the given elastictab-instance into streaming mode
+ *
+ * \para eprint		current elastictab instance, MUST not contain any
+ *			lines yet
+ * \para fd		the target file-descriptor for the output
+ *
+ * \returns EINVAL	in case a parameter is considered wrong, or the
+ *			instance already contains lines
+ * \returns 0		in case everything went OK
+ *
+ * In streaming mode the lines are not kept until a final `*put()`, but
+ * written to `fd` block by block while they are added. The instance uses
+ * column blocks (see `ELASTIC_PRINT_BLOCKS`) from then on. A column block ends
+ * with the first line that has fewer cells, so once a line without any
+ * elastic cell is added, all blocks before it are closed and can be written
+ * out. Their storage is then reused, so the memory needed is bounded by the
+ * largest block (and some buffered output) and not the whole input.
+ *
+ * `elastic_print_add_*()` can return the errors of `elastic_print_fdput()` in
+ * this mode. The line was added anyway then, and no line is released before
+ * it was written, so the failed write is tried again with the next closed
+ * block or by `elastic_print_stream_finish()`. The `*put()`-functions only
+ * print the lines not yet written.
+ */
+int elastic_print_stream(struct elastic_print *eprint, int fd);
+
+/** writes all lines left in streaming mode and ends the streaming mode
+ *
+ * \para eprint		current elastictab instance
+ *
+ * \returns EINVAL	in case the instance is not in streaming mode
+ * \returns `elastic_print_fdput()`
+ *			errors reported while writing the remaining lines,
+ *			the instance stays in streaming mode with all its
+ *			lines then, so the call can be repeated
+ * \returns 0		in case everything went OK
+ */
+int elastic_print_stream_finish(struct elastic_print *eprint);
+
+/** puts the given elastictab-instance into spill mode
+ *
+ * \para eprint		current elastictab instance, MUST not contain any
+ *			lines yet
+ * \para budget		number of bytes of stored lines kept in memory, at
+ *			least one storage-chunk (64 KiB) is always used
+ * \para directory	where the spill-file is created, or NULL to use
+ *			`$TMPDIR` (or /tmp if that is not set)
+ *
+ * \returns EINVAL	in case a parameter is considered wrong, the instance
+ *			already contains lines, is in streaming mode, or was
+ *			created with `ELASTIC_PRINT_UPDATE` or
+ *			`ELASTIC_PRINT_CONCURRENT`
+ * \returns ENOMEM	in case not enough memory could be allocated
+ * \returns errno	as reported by `mkstemp()`
+ * \returns 0		in case everything went OK
+ *
+ * In spill mode all stored lines are appended to a temporary file, once
+ * more than `budget` bytes of them are held in memory, and their storage is
+ * reused for the following lines. The file is already removed from the
+ * directory, and is gone with the instance. Only the text of the lines is
+ * moved; the index of the lines and cells, and the column widths stay in
+ * memory.
+ *
+ * The `*put()`-functions map the file and read it sequentially; the pages
+ * are only held in the page-cache, so the table can be bigger than the
+ * memory available. Lines added with `elastic_print_add_borrowed()` are
+ * copied in this mode, and `elastic_print_add_bulk()` adds with a single
+ * thread.
+ *
+ * `elastic_print_add_*()` can return the errors of `writev()` in this mode,
+ * the lines added so far stay in the instance then.
+ */
+int elastic_print_spill(struct elastic_print *eprint, size_t budget,
+			const char *directory);
+
+/** drops all lines of the given elastictab-instance, to fill it again
+ *
+ * \para eprint		current elastictab instance
+ *
+ * \returns EINVAL	in case a parameter is considered wrong, or the
+ *			instance is in streaming mode
+ * \returns errno	as reported by `ftruncate()` in spill mode, nothing
+ *			is dropped then
+ * \returns 0		in case everything went OK
+ *
+ * The instance is left as if it was just created with the same parameters,
+ * but all memory it allocated so far (line storage, index, per-column
+ * arrays, render buffers) is kept. Filling it again with a table of the same
+ * shape and printing it then doesn't allocate anything. Lines added with
+ * `elastic_print_add_borrowed()` can be released by the caller after this,
+ * the files mapped by `elastic_print_add_fd()` are unmapped.
+ * In spill mode the spill-file is emptied. The statistics are not reset.
+ */
+int elastic_print_reset(struct elastic_print *eprint);
+
+/** copies the counters of the given elastictab-instance
+ *
+ * \para eprint		current elastictab instance
+ * \para stats		filled with the counters of `eprint`
+ */
+void elastic_print_get_stats(const struct elastic_print *eprint,
+			     struct elastic_print_stats *stats);
+
+/** prints the counters of the given elastictab-instance in one line
+ *
+ * \para eprint		current elastictab instance
+ * \para stream		the target stream that shall be used
+ *
+ * \returns EINVAL	in case a parameter is considered wrong
+ * \returns EOF		in case printing into the stream fails
+ * \returns 0		in case everything went OK
+ */
+int elastic_print_stats_fput(const struct elastic_print *eprint,
+			     FILE *stream);
+
 #endif /* __ELASTICTAB_H */
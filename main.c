@@ -17,154 +17,197 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#define _XOPEN_SOURCE 700
+
 #include "stdio.h"
 #include "stdlib.h"
 #include "errno.h"
-#include "assert.h"
 #include "string.h"
+#include "limits.h"
+#include "unistd.h"
+#include "fcntl.h"
 
 #include "elastictab.h"
 
-#define __test_exec_and_expr(rc, command, test_expr, fail_label)               \
-	{                                                                      \
-		rc = command;                                                  \
-		if (!(test_expr)) {                                            \
-			fprintf(stderr,                                        \
-				"test_exec @ <%s:%s:%d> failed with [%d]\n",   \
-				__FILE__, __func__, __LINE__, rc);             \
-			goto fail_label;                                       \
-		}                                                              \
-	}
-#define __test_exec_and_rc0(rc, command, fail_label)                           \
-	{                                                                      \
-		__test_exec_and_expr(rc, command, (rc) == 0, fail_label);      \
-	}
+#ifndef VERSION
+#define VERSION "unknown"
+#endif
 
-int test_basic()
+static void usage(FILE *stream, const char *name)
 {
-	int rc = 0;
-#define __test_basic_buffer_length	(1 << 10)
-	char test_buffer[__test_basic_buffer_length];
-	char test_buffer_check[__test_basic_buffer_length] =
-	    "aaaaaaaaa  aaa       aaaaaaaaa  \n"
-	    "bbbb       bbbbbbbbb bbb        \n"
-	    "cccccccccc cc        cccccccccc cc\n"
-	    "                     ccccccc    \n"
-	    "abc        abc       abc\n"
-	    "                     abcabca    abcabc\tabcabc\n\0";
-	size_t test_buffer_check_strlen = strlen(test_buffer_check);
-
-	struct elastic_print ep;
-
-	__test_exec_and_rc0(rc, elastic_print_create(&ep, 3, 8), err);
-
-	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
-				"aaaaaaaaa\taaa\taaaaaaaaa"), err_destroy_ep);
-	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
-				"bbbb\tbbbbbbbbb\tbbb"), err_destroy_ep);
-	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
-				"cccccccccc\tcc\tcccccccccc\tcc"),
-			    err_destroy_ep);
-	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
-				"\t\tccccccc"), err_destroy_ep);
-	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
-				"abc\tabc\tabc\n\t\tabcabca\tabcabc\tabcabc"), 
-			    err_destroy_ep);
-
-	fprintf(stdout, "%zd, %zd, [%zd, %zd, %zd], %zd\n", ep.columns,
-		ep.lines_count, ep.column_widths[0], ep.column_widths[1],
-		ep.column_widths[2], ep.column_widths_min);
-
-	__test_exec_and_expr(
-	    rc,
-	    elastic_print_snput(&ep, test_buffer, __test_basic_buffer_length),
-	    rc == (int)test_buffer_check_strlen, err_destroy_ep);
-
-	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
-			    err_destroy_ep);
-
-	elastic_print_destory(&ep);
-
-	fputs(test_buffer, stdout);
-
-/* out: */
-	assert(rc == 0);
-	return rc;
-err_destroy_ep:
-	elastic_print_destory(&ep);
-err:
-	assert(rc != 0);
-	return rc;
+	fprintf(stream,
+		"Usage: %s [OPTION]... [FILE]...\n"
+		"Aligns the tab-separated columns of each FILE (or standard "
+		"input)\nwith elastic tabstops and writes them to standard "
+		"output.\n"
+		"\n"
+		"  -c COLUMNS   only the first COLUMNS columns are elastic "
+		"(default: all)\n"
+		"  -m WIDTH     minimum width of a column, including its "
+		"padding\n"
+		"               (default: 1)\n"
+		"  -b           scope the column widths to blocks of adjacent "
+		"lines,\n"
+		"               instead of the whole input\n"
+		"  -j THREADS   number of threads to measure the input with "
+		"(default:\n"
+		"               one per online CPU)\n"
+		"  -M BYTES     keep at most BYTES of the input in memory, the "
+		"rest is\n"
+		"               moved to a temporary file in $TMPDIR\n"
+		"  -h           print this help and exit\n"
+		"  -V           print the version and exit\n"
+		"\n"
+		"With no FILE, or when FILE is -, standard input is read.\n",
+		name);
 }
 
-int test_zero_columns()
+/** parses `arg` as a decimal number into `value`
+ *
+ * \returns EINVAL	in case `arg` is not a number or out of range
+ * \returns 0		if everything went OK
+ */
+static int parse_size(const char *arg, size_t *value)
 {
-	int rc = 0;
-#define __test_basic_buffer_length	(1 << 10)
-	char test_buffer[__test_basic_buffer_length];
-	char test_buffer_check[__test_basic_buffer_length] =
-	    "aaaaaaaaa\taaa\taaaaaaaaa\n"
-	    "bbbb\tbbbbbbbbb\tbbb\n"
-	    "cccccccccc\tcc\tcccccccccc\tcc\n"
-	    "\t\tccccccc\n"
-	    "abc\tabc\tabc\n\t\tabcabca\n\0";
-	size_t test_buffer_check_strlen = strlen(test_buffer_check);
+	unsigned long long parsed;
+	char *end;
 
-	struct elastic_print ep;
-
-	__test_exec_and_rc0(rc, elastic_print_create(&ep, 0, 8), err);
+	if ((arg[0] < '0') || (arg[0] > '9')) {
+		return EINVAL;
+	}
 
-	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
-				"aaaaaaaaa\taaa\taaaaaaaaa"), err_destroy_ep);
-	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
-				"bbbb\tbbbbbbbbb\tbbb"), err_destroy_ep);
-	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
-				"cccccccccc\tcc\tcccccccccc\tcc"),
-			    err_destroy_ep);
-	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
-				"\t\tccccccc"), err_destroy_ep);
-	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
-				"abc\tabc\tabc\n\t\tabcabca"), err_destroy_ep);
+	errno = 0;
+	parsed = strtoull(arg, &end, 10);
+	if ((errno != 0) || (*end != '\0') || (parsed > SIZE_MAX)) {
+		return EINVAL;
+	}
 
-	fprintf(stdout, "%zd, %zd, %zd\n", ep.columns, ep.lines_count,
-		ep.column_widths_min);
+	*value = (size_t) parsed;
+	return 0;
+}
 
-	__test_exec_and_expr(
-	    rc,
-	    elastic_print_snput(&ep, test_buffer, __test_basic_buffer_length),
-	    rc == (int)test_buffer_check_strlen, err_destroy_ep);
+/** adds everything in the file `path` (or stdin for "-") to `eprint` */
+static int add_path(struct elastic_print *eprint, const char *path,
+		    unsigned int threads)
+{
+	int rc, fd;
 
-	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
-			    err_destroy_ep);
+	if (strcmp(path, "-") == 0) {
+		return elastic_print_add_fd(eprint, STDIN_FILENO, threads);
+	}
 
-	elastic_print_destory(&ep);
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return errno;
+	}
 
-	fputs(test_buffer, stdout);
+	rc = elastic_print_add_fd(eprint, fd, threads);
 
-/* out: */
-	assert(rc == 0);
-	return rc;
-err_destroy_ep:
-	elastic_print_destory(&ep);
-err:
-	assert(rc != 0);
+	close(fd);
 	return rc;
 }
 
 int
-main()
+main(int argc, char *argv[])
 {
-	int rc = 0;
+	int rc = EXIT_FAILURE, err, opt;
 
-	fprintf(stdout, "running test 'test_basic()' .. \n");
-	__test_exec_and_rc0(rc, test_basic(), err);
+	struct elastic_print ep;
+	size_t columns = 0, column_widths_min = 1, threads = 0, budget = 0;
+	unsigned int flags = ELASTIC_PRINT_DYNAMIC;
+	const char *path = "-";
+	int i;
+
+	while ((opt = getopt(argc, argv, "c:m:bj:M:hV")) != -1) {
+		switch (opt) {
+		case 'c':
+			err = parse_size(optarg, &columns);
+			if ((err != 0) || (columns == 0)) {
+				fprintf(stderr, "%s: invalid column count "
+					"'%s'\n", argv[0], optarg);
+				goto err;
+			}
+			break;
+		case 'm':
+			err = parse_size(optarg, &column_widths_min);
+			if ((err != 0) || (column_widths_min == 0)) {
+				fprintf(stderr, "%s: invalid minimum width "
+					"'%s'\n", argv[0], optarg);
+				goto err;
+			}
+			break;
+		case 'b':
+			flags |= ELASTIC_PRINT_BLOCKS;
+			break;
+		case 'j':
+			err = parse_size(optarg, &threads);
+			if ((err != 0) || (threads > UINT_MAX)) {
+				fprintf(stderr, "%s: invalid thread count "
+					"'%s'\n", argv[0], optarg);
+				goto err;
+			}
+			break;
+		case 'M':
+			err = parse_size(optarg, &budget);
+			if ((err != 0) || (budget == 0)) {
+				fprintf(stderr, "%s: invalid memory budget "
+					"'%s'\n", argv[0], optarg);
+				goto err;
+			}
+			break;
+		case 'h':
+			usage(stdout, argv[0]);
+			rc = EXIT_SUCCESS;
+			goto err;
+		case 'V':
+			fprintf(stdout, "elastictab %s\n", VERSION);
+			rc = EXIT_SUCCESS;
+			goto err;
+		default:
+			usage(stderr, argv[0]);
+			goto err;
+		}
+	}
 
-	fputs("\n", stdout);
+	err = elastic_print_create_flags(&ep, columns, column_widths_min,
+					 flags);
+	if (err != 0) {
+		fprintf(stderr, "%s: %s\n", argv[0], strerror(err));
+		goto err;
+	}
 
-	fprintf(stdout, "running test 'test_zero_columns()' .. \n");
-	__test_exec_and_rc0(rc, test_zero_columns(), err);
+	if (budget > 0) {
+		err = elastic_print_spill(&ep, budget, NULL);
+		if (err != 0) {
+			fprintf(stderr, "%s: %s\n", argv[0], strerror(err));
+			goto err_destroy_ep;
+		}
+	}
 
-	return EXIT_SUCCESS;
+	i = optind;
+	do {
+		if (i < argc) {
+			path = argv[i];
+		}
+
+		err = add_path(&ep, path, (unsigned int) threads);
+		if (err != 0) {
+			fprintf(stderr, "%s: %s: %s\n", argv[0], path,
+				strerror(err));
+			goto err_destroy_ep;
+		}
+	} while (++i < argc);
+
+	err = elastic_print_fdput(&ep, STDOUT_FILENO);
+	if (err != 0) {
+		fprintf(stderr, "%s: write error: %s\n", argv[0],
+			strerror(err));
+		goto err_destroy_ep;
+	}
+
+	rc = EXIT_SUCCESS;
+err_destroy_ep:
+	elastic_print_destory(&ep);
 err:
-	return EXIT_FAILURE;
+	return rc;
 }
@@ -0,0 +1,2098 @@
+/*
+ * elastictab: a simple implementation of elastic tabstops in C
+ * Copyright (C) 2014  Benjamin Block (bebl@mageta.org)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "errno.h"
+#include "assert.h"
+#include "string.h"
+#include "stdint.h"
+#include "pthread.h"
+#include "unistd.h"
+
+#include "elastictab.h"
+
+#define __test_exec_and_expr(rc, command, test_expr, fail_label)               \
+	{                                                                      \
+		rc = command;                                                  \
+		if (!(test_expr)) {                                            \
+			fprintf(stderr,                                        \
+				"test_exec @ <%s:%s:%d> failed with [%d]\n",   \
+				__FILE__, __func__, __LINE__, rc);             \
+			goto fail_label;                                       \
+		}                                                              \
+	}
+#define __test_exec_and_rc0(rc, command, fail_label)                           \
+	{                                                                      \
+		__test_exec_and_expr(rc, command, (rc) == 0, fail_label);      \
+	}
+
+int test_basic()
+{
+	int rc = 0;
+#define __test_basic_buffer_length	(1 << 10)
+	char test_buffer[__test_basic_buffer_length];
+	char test_buffer_check[__test_basic_buffer_length] =
+	    "aaaaaaaaa  aaa       aaaaaaaaa  \n"
+	    "bbbb       bbbbbbbbb bbb        \n"
+	    "cccccccccc cc        cccccccccc cc\n"
+	    "                     ccccccc    \n"
+	    "abc        abc       abc\n"
+	    "                     abcabca    abcabc\tabcabc\n\0";
+	size_t test_buffer_check_strlen = strlen(test_buffer_check);
+
+	struct elastic_print ep;
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 3, 8), err);
+
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"aaaaaaaaa\taaa\taaaaaaaaa"), err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"bbbb\tbbbbbbbbb\tbbb"), err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"cccccccccc\tcc\tcccccccccc\tcc"),
+			    err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"\t\tccccccc"), err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"abc\tabc\tabc\n\t\tabcabca\tabcabc\tabcabc"), 
+			    err_destroy_ep);
+
+	fprintf(stdout, "%zd, %zd, [%zd, %zd, %zd], %zd\n", ep.columns,
+		ep.lines_count, ep.column_widths[0], ep.column_widths[1],
+		ep.column_widths[2], ep.column_widths_min);
+
+	__test_exec_and_expr(
+	    rc,
+	    elastic_print_snput(&ep, test_buffer, __test_basic_buffer_length),
+	    rc == (int)test_buffer_check_strlen, err_destroy_ep);
+
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_destroy_ep);
+
+	elastic_print_destory(&ep);
+
+	fputs(test_buffer, stdout);
+
+/* out: */
+	assert(rc == 0);
+	return rc;
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_zero_columns()
+{
+	int rc = 0;
+#define __test_basic_buffer_length	(1 << 10)
+	char test_buffer[__test_basic_buffer_length];
+	char test_buffer_check[__test_basic_buffer_length] =
+	    "aaaaaaaaa\taaa\taaaaaaaaa\n"
+	    "bbbb\tbbbbbbbbb\tbbb\n"
+	    "cccccccccc\tcc\tcccccccccc\tcc\n"
+	    "\t\tccccccc\n"
+	    "abc\tabc\tabc\n\t\tabcabca\n\0";
+	size_t test_buffer_check_strlen = strlen(test_buffer_check);
+
+	struct elastic_print ep;
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 0, 8), err);
+
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"aaaaaaaaa\taaa\taaaaaaaaa"), err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"bbbb\tbbbbbbbbb\tbbb"), err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"cccccccccc\tcc\tcccccccccc\tcc"),
+			    err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"\t\tccccccc"), err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"abc\tabc\tabc\n\t\tabcabca"), err_destroy_ep);
+
+	fprintf(stdout, "%zd, %zd, %zd\n", ep.columns, ep.lines_count,
+		ep.column_widths_min);
+
+	__test_exec_and_expr(
+	    rc,
+	    elastic_print_snput(&ep, test_buffer, __test_basic_buffer_length),
+	    rc == (int)test_buffer_check_strlen, err_destroy_ep);
+
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_destroy_ep);
+
+	elastic_print_destory(&ep);
+
+	fputs(test_buffer, stdout);
+
+/* out: */
+	assert(rc == 0);
+	return rc;
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_measure()
+{
+	int rc = 0;
+	char *test_buffer;
+	size_t test_buffer_length;
+
+	struct elastic_print ep;
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 3, 8), err);
+
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"aaaaaaaaa\taaa\taaaaaaaaa"), err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"cccccccccc\tcc\tcccccccccc\tcc"),
+			    err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"abc\tabc\tabc\n\t\tabcabca\tabcabc\tabcabc"),
+			    err_destroy_ep);
+
+	test_buffer_length = elastic_print_measure(&ep);
+	fprintf(stdout, "measured %zd characters\n", test_buffer_length);
+
+	test_buffer = malloc(test_buffer_length + 1);
+	__test_exec_and_expr(rc, (test_buffer == NULL) ? ENOMEM : 0, rc == 0,
+			     err_destroy_ep);
+
+	/* one character short of the 0-terminator */
+	__test_exec_and_expr(
+	    rc, elastic_print_snput(&ep, test_buffer, test_buffer_length),
+	    rc == -ENOMEM, err_free_buffer);
+
+	__test_exec_and_expr(
+	    rc, elastic_print_snput(&ep, test_buffer, test_buffer_length + 1),
+	    rc == (int)test_buffer_length, err_free_buffer);
+
+	__test_exec_and_expr(rc, (int)strlen(test_buffer),
+			     rc == (int)test_buffer_length, err_free_buffer);
+
+	fputs(test_buffer, stdout);
+
+	free(test_buffer);
+	elastic_print_destory(&ep);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_free_buffer:
+	free(test_buffer);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_fdput()
+{
+	int rc = 0;
+	char *test_buffer, *test_buffer_check;
+	size_t test_buffer_length;
+	FILE *test_file;
+	int i;
+
+	struct elastic_print ep;
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 2, 4), err);
+
+	/* enough lines and padding to need more than one `writev()` */
+	for (i = 0; i < 1000; i++) {
+		__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+					"%d\t%*s\t%d", i, i % 300, "", i * i),
+				    err_destroy_ep);
+	}
+
+	test_buffer_length = elastic_print_measure(&ep);
+	test_buffer = calloc(2 * (test_buffer_length + 1), 1);
+	__test_exec_and_expr(rc, (test_buffer == NULL) ? ENOMEM : 0, rc == 0,
+			     err_destroy_ep);
+	test_buffer_check = &test_buffer[test_buffer_length + 1];
+
+	test_file = tmpfile();
+	__test_exec_and_expr(rc, (test_file == NULL) ? errno : 0, rc == 0,
+			     err_free_buffer);
+
+	__test_exec_and_rc0(rc, elastic_print_fdput(&ep, fileno(test_file)),
+			    err_close_file);
+
+	rewind(test_file);
+	__test_exec_and_expr(rc, (int)fread(test_buffer, 1,
+					    test_buffer_length + 1, test_file),
+			     rc == (int)test_buffer_length, err_close_file);
+
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, test_buffer_check,
+						    test_buffer_length + 1),
+			     rc == (int)test_buffer_length, err_close_file);
+
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_close_file);
+
+	fprintf(stdout, "wrote %zd characters\n", test_buffer_length);
+
+	fclose(test_file);
+	free(test_buffer);
+	elastic_print_destory(&ep);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_close_file:
+	fclose(test_file);
+err_free_buffer:
+	free(test_buffer);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_stream()
+{
+	int rc = 0;
+#define __test_stream_buffer_length	(1 << 10)
+	char test_buffer[__test_stream_buffer_length];
+	char test_buffer_check[__test_stream_buffer_length] =
+	    "a   bb c\n"
+	    "aaa b\n"
+	    "plain\n"
+	    "x  y\n"
+	    "xx y\n";
+	size_t test_buffer_check_strlen = strlen(test_buffer_check);
+	FILE *test_file;
+	int test_pipe[2];
+	int i;
+
+	struct elastic_print ep;
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 2, 1), err);
+
+	test_file = tmpfile();
+	__test_exec_and_expr(rc, (test_file == NULL) ? errno : 0, rc == 0,
+			     err_destroy_ep);
+
+	__test_exec_and_rc0(rc, elastic_print_stream(&ep, fileno(test_file)),
+			    err_close_file);
+
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"a\tbb\tc\naaa\tb\nplain"), err_close_file);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep, "x\ty"),
+			    err_close_file);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep, "xx\ty"),
+			    err_close_file);
+	__test_exec_and_rc0(rc, elastic_print_stream_finish(&ep),
+			    err_close_file);
+
+	rewind(test_file);
+	memset(test_buffer, 0, sizeof(test_buffer));
+	__test_exec_and_expr(rc, (int)fread(test_buffer, 1,
+					    sizeof(test_buffer) - 1, test_file),
+			     rc == (int)test_buffer_check_strlen,
+			     err_close_file);
+
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_close_file);
+
+	fputs(test_buffer, stdout);
+
+	/* lines that could not be written are kept, and written again */
+	__test_exec_and_rc0(rc, (pipe(test_pipe) != 0) ? errno : 0,
+			    err_close_file);
+	rewind(test_file);
+	__test_exec_and_rc0(rc, elastic_print_stream(&ep, test_pipe[0]),
+			    err_close_pipe);
+
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"a\tbb\tc\naaa\tb\nplain\nx\ty\nxx\ty"),
+			    err_close_pipe);
+	__test_exec_and_expr(rc, elastic_print_stream_finish(&ep),
+			     rc == EBADF, err_close_pipe);
+	__test_exec_and_expr(rc, (int)ep.lines_count, rc == 5, err_close_pipe);
+
+	ep.stream_fd = fileno(test_file);
+	__test_exec_and_rc0(rc, elastic_print_stream_finish(&ep),
+			    err_close_pipe);
+	close(test_pipe[0]);
+	close(test_pipe[1]);
+
+	rewind(test_file);
+	memset(test_buffer, 0, sizeof(test_buffer));
+	__test_exec_and_expr(rc, (int)fread(test_buffer, 1,
+					    sizeof(test_buffer) - 1, test_file),
+			     rc == (int)test_buffer_check_strlen,
+			     err_close_file);
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_close_file);
+
+	/* closed blocks are written and released after a while */
+	rewind(test_file);
+	__test_exec_and_rc0(rc, elastic_print_stream(&ep, fileno(test_file)),
+			    err_close_file);
+
+	for (i = 0; i < 100000; i++) {
+		__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+					(i % 10) ? "%d\t%d\t%d" : "%d",
+					i, i, i), err_close_file);
+		__test_exec_and_expr(rc, (int)ep.lines_count, rc < 10000,
+				     err_close_file);
+	}
+
+	__test_exec_and_rc0(rc, elastic_print_stream_finish(&ep),
+			    err_close_file);
+
+	fclose(test_file);
+	elastic_print_destory(&ep);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_close_pipe:
+	close(test_pipe[0]);
+	close(test_pipe[1]);
+err_close_file:
+	fclose(test_file);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_blocks()
+{
+	int rc = 0;
+#define __test_blocks_buffer_length	(1 << 10)
+	char test_buffer[__test_blocks_buffer_length];
+	char test_buffer_check[__test_blocks_buffer_length] =
+	    "a    b c\n"
+	    "aaaa b\n"
+	    "x\n"
+	    "y  zzzzzz w\n"
+	    "yy z      w\n";
+	size_t test_buffer_check_strlen = strlen(test_buffer_check);
+
+	struct elastic_print ep;
+
+	__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 3, 1,
+				ELASTIC_PRINT_BLOCKS), err);
+
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"a\tb\tc\naaaa\tb\nx"), err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"y\tzzzzzz\tw"), err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"yy\tz\tw"), err_destroy_ep);
+
+	fprintf(stdout, "%zd, %zd, [%zd, %zd, %zd], %zd\n", ep.columns,
+		ep.lines_count, ep.column_widths[0], ep.column_widths[1],
+		ep.column_widths[2], ep.column_widths_min);
+
+	__test_exec_and_expr(
+	    rc, (int)elastic_print_measure(&ep),
+	    rc == (int)test_buffer_check_strlen, err_destroy_ep);
+
+	__test_exec_and_expr(
+	    rc,
+	    elastic_print_snput(&ep, test_buffer, __test_blocks_buffer_length),
+	    rc == (int)test_buffer_check_strlen, err_destroy_ep);
+
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_destroy_ep);
+
+	elastic_print_destory(&ep);
+
+	fputs(test_buffer, stdout);
+
+/* out: */
+	assert(rc == 0);
+	return rc;
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_dynamic()
+{
+	int rc = 0;
+#define __test_dynamic_buffer_length	(1 << 10)
+	char test_buffer[__test_dynamic_buffer_length];
+	char test_buffer_check[__test_dynamic_buffer_length] =
+	    "a   b  \n"
+	    "aaa bb c \n"
+	    "a   b  c dddd \n";
+	size_t test_buffer_check_strlen = strlen(test_buffer_check);
+
+	struct elastic_print ep;
+
+	__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 0, 1,
+				ELASTIC_PRINT_DYNAMIC), err);
+
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep, "a\tb"),
+			    err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.columns, rc == 2, err_destroy_ep);
+
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep, "aaa\tbb\tc"),
+			    err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+				"a\tb\tc\tdddd"), err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.columns, rc == 4, err_destroy_ep);
+
+	fprintf(stdout, "%zd, %zd, [%zd, %zd, %zd, %zd], %zd\n", ep.columns,
+		ep.lines_count, ep.column_widths[0], ep.column_widths[1],
+		ep.column_widths[2], ep.column_widths[3],
+		ep.column_widths_min);
+
+	__test_exec_and_expr(
+	    rc,
+	    elastic_print_snput(&ep, test_buffer, __test_dynamic_buffer_length),
+	    rc == (int)test_buffer_check_strlen, err_destroy_ep);
+
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_destroy_ep);
+
+	elastic_print_destory(&ep);
+
+	fputs(test_buffer, stdout);
+
+	/* with a maximum, the tabs behind it are not elastic */
+	__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 1, 1,
+				ELASTIC_PRINT_DYNAMIC), err);
+
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep, "aaa\tbb\tc"),
+			    err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.columns, rc == 1, err_destroy_ep);
+
+	elastic_print_destory(&ep);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_utf8()
+{
+	int rc = 0;
+#define __test_utf8_buffer_length	(1 << 10)
+	char test_buffer[__test_utf8_buffer_length];
+	/* wide CJK characters, a combining accent and an invalid byte */
+	char test_buffer_check[__test_utf8_buffer_length] =
+	    "\xe6\x97\xa5\xe6\x9c\xac x\n"
+	    "e\xcc\x81    x\n"
+	    "\xff    x\n"
+	    "abcd x\n";
+	char test_input[] =
+	    "\xe6\x97\xa5\xe6\x9c\xac\tx\n"
+	    "e\xcc\x81\tx\n"
+	    "\xff\tx\n"
+	    "abcd\tx\n";
+	size_t test_buffer_check_strlen = strlen(test_buffer_check);
+
+	struct elastic_print ep;
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 1, 1), err);
+
+	__test_exec_and_rc0(rc, elastic_print_add_string(&ep, test_input),
+			    err_destroy_ep);
+
+	__test_exec_and_expr(rc, (int)ep.column_widths[0], rc == 5,
+			     err_destroy_ep);
+
+	__test_exec_and_expr(
+	    rc,
+	    elastic_print_snput(&ep, test_buffer, __test_utf8_buffer_length),
+	    rc == (int)test_buffer_check_strlen, err_destroy_ep);
+
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_destroy_ep);
+
+	elastic_print_destory(&ep);
+
+	fputs(test_buffer, stdout);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+/** generates `lines` lines with three columns of varying width */
+static char *test_input_alloc(size_t lines, size_t *length)
+{
+	char *input, *cur;
+	size_t i;
+
+	input = malloc(lines * 32);
+	if (input == NULL) {
+		return NULL;
+	}
+
+	for (cur = input, i = 0; i < lines; i++) {
+		cur += sprintf(cur, "%zu\t%.*s\t%s%s", i, (int)(i % 7), "xxxxxxx",
+			       (i % 5 == 0) ? "" : "z\t",
+			       (i % 3 == 0) ? "\r\n" : "\n");
+	}
+
+	*length = (size_t)(cur - input);
+	return input;
+}
+
+int test_bulk()
+{
+	int rc = 0;
+#define __test_bulk_lines	(1 << 18)
+	char *input, *output, *output_check;
+	size_t input_length, output_length;
+	unsigned int flags;
+	FILE *file;
+
+	struct elastic_print ep, ep_check;
+
+	/* a few MiB, so the input is split up between the threads */
+	input = test_input_alloc(__test_bulk_lines, &input_length);
+	if (input == NULL) {
+		rc = ENOMEM;
+		goto err;
+	}
+
+	for (flags = 0; flags <= ELASTIC_PRINT_BLOCKS;
+	     flags += ELASTIC_PRINT_BLOCKS) {
+		__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 3, 1,
+					flags), err_free_input);
+		__test_exec_and_rc0(rc, elastic_print_create_flags(&ep_check, 3,
+					1, flags), err_destroy_ep);
+
+		__test_exec_and_rc0(rc, elastic_print_add_bulk(&ep, input,
+					input_length, 4), err_destroy_ep_check);
+		__test_exec_and_rc0(rc, elastic_print_add_line(&ep_check, input,
+					input_length), err_destroy_ep_check);
+
+		__test_exec_and_expr(rc, (int)ep.lines_count,
+				     ep.lines_count == __test_bulk_lines,
+				     err_destroy_ep_check);
+
+		output_length = elastic_print_measure(&ep_check);
+		__test_exec_and_expr(rc, (int)elastic_print_measure(&ep),
+				     elastic_print_measure(&ep) == output_length,
+				     err_destroy_ep_check);
+
+		output = malloc(output_length + 1);
+		output_check = malloc(output_length + 1);
+		if ((output == NULL) || (output_check == NULL)) {
+			rc = ENOMEM;
+			goto err_free_output;
+		}
+
+		__test_exec_and_expr(rc, elastic_print_snput(&ep, output,
+					output_length + 1),
+				     rc == (int)output_length, err_free_output);
+		__test_exec_and_expr(rc, elastic_print_snput(&ep_check,
+					output_check, output_length + 1),
+				     rc == (int)output_length, err_free_output);
+		__test_exec_and_rc0(rc, strcmp(output, output_check),
+				    err_free_output);
+
+		free(output);
+		free(output_check);
+		elastic_print_destory(&ep_check);
+		elastic_print_destory(&ep);
+	}
+
+	/* the same from a file */
+	file = tmpfile();
+	if (file == NULL) {
+		rc = errno;
+		goto err_free_input;
+	}
+	if ((fwrite(input, 1, input_length, file) != input_length) ||
+	    (fflush(file) != 0)) {
+		rc = EIO;
+		goto err_close_file;
+	}
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 3, 1),
+			    err_close_file);
+	__test_exec_and_rc0(rc, elastic_print_add_fd(&ep, fileno(file), 4),
+			    err_destroy_ep_file);
+	__test_exec_and_expr(rc, (int)ep.lines_count,
+			     ep.lines_count == __test_bulk_lines,
+			     err_destroy_ep_file);
+	fprintf(stdout, "%zd, %zd, [%zd, %zd, %zd], %zd\n", ep.columns,
+		ep.lines_count, ep.column_widths[0], ep.column_widths[1],
+		ep.column_widths[2], elastic_print_measure(&ep));
+
+	/* the lines are borrowed from the mapping, which outlives the file */
+	fclose(file);
+	__test_exec_and_expr(rc, (int)ep.lines_borrowed,
+			     ep.lines_borrowed == __test_bulk_lines,
+			     err_destroy_ep);
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep_check, 3, 1),
+			    err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_line(&ep_check, input,
+				input_length), err_destroy_ep_check);
+
+	output_length = elastic_print_measure(&ep_check);
+	output = malloc(output_length + 1);
+	output_check = malloc(output_length + 1);
+	if ((output == NULL) || (output_check == NULL)) {
+		rc = ENOMEM;
+		goto err_free_output;
+	}
+
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, output,
+				output_length + 1),
+			     rc == (int)output_length, err_free_output);
+	__test_exec_and_expr(rc, elastic_print_snput(&ep_check,
+				output_check, output_length + 1),
+			     rc == (int)output_length, err_free_output);
+	__test_exec_and_rc0(rc, strcmp(output, output_check),
+			    err_free_output);
+
+	/* which is released again with the lines */
+	__test_exec_and_rc0(rc, elastic_print_reset(&ep), err_free_output);
+	__test_exec_and_expr(rc, 0, ep.mappings == NULL, err_free_output);
+
+	free(output);
+	free(output_check);
+	elastic_print_destory(&ep_check);
+	elastic_print_destory(&ep);
+	free(input);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep_file:
+	elastic_print_destory(&ep);
+err_close_file:
+	fclose(file);
+	goto err_free_input;
+err_free_output:
+	free(output);
+	free(output_check);
+err_destroy_ep_check:
+	elastic_print_destory(&ep_check);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err_free_input:
+	free(input);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_render()
+{
+	int rc = 0;
+#define __test_render_lines	(1 << 18)
+	char *input, *output, *output_check;
+	size_t input_length, output_length;
+	unsigned int flags;
+	FILE *file;
+
+	struct elastic_print ep;
+
+	input = test_input_alloc(__test_render_lines, &input_length);
+	if (input == NULL) {
+		rc = ENOMEM;
+		goto err;
+	}
+
+	for (flags = 0; flags <= ELASTIC_PRINT_BLOCKS;
+	     flags += ELASTIC_PRINT_BLOCKS) {
+		__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 3, 1,
+					flags), err_free_input);
+		__test_exec_and_rc0(rc, elastic_print_add_line(&ep, input,
+					input_length), err_destroy_ep);
+
+		output_length = elastic_print_measure(&ep);
+		output = malloc(output_length + 1);
+		output_check = malloc(output_length + 1);
+		if ((output == NULL) || (output_check == NULL)) {
+			rc = ENOMEM;
+			goto err_free_output;
+		}
+
+		__test_exec_and_expr(rc, elastic_print_snput_threads(&ep,
+					output, output_length + 1, 4),
+				     rc == (int)output_length, err_free_output);
+		__test_exec_and_expr(rc, elastic_print_snput(&ep, output_check,
+					output_length + 1),
+				     rc == (int)output_length, err_free_output);
+		__test_exec_and_rc0(rc, strcmp(output, output_check),
+				    err_free_output);
+
+		/* too small, rendered serially as far as it goes */
+		__test_exec_and_expr(rc, elastic_print_snput_threads(&ep,
+					output, output_length, 4),
+				     rc == -ENOMEM, err_free_output);
+
+		file = tmpfile();
+		if (file == NULL) {
+			rc = errno;
+			goto err_free_output;
+		}
+		rc = elastic_print_fput_threads(&ep, file, 0);
+		if (rc == 0) {
+			rewind(file);
+			rc = (fread(output, 1, output_length + 1, file) ==
+			      output_length) ? 0 : EIO;
+		}
+		fclose(file);
+		__test_exec_and_rc0(rc, memcmp(output, output_check,
+					       output_length), err_free_output);
+
+		free(output);
+		free(output_check);
+		elastic_print_destory(&ep);
+	}
+
+	free(input);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_free_output:
+	free(output);
+	free(output_check);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err_free_input:
+	free(input);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_update()
+{
+	int rc = 0;
+#define __test_update_buffer_length	(1 << 10)
+	char test_buffer[__test_update_buffer_length];
+	char test_buffer_check[__test_update_buffer_length] =
+	    "a   bb c\n"
+	    "ddd e  f\n"
+	    "g   h  i\n";
+	char test_buffer_check_removed[__test_update_buffer_length] =
+	    "a bb c\n"
+	    "g h  i\n";
+	char test_input[] =
+	    "a\tbb\tc\n"
+	    "dddddddd\te\tf\n"
+	    "g\th\ti\n";
+
+	struct elastic_print ep;
+
+	__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 2, 1,
+				ELASTIC_PRINT_UPDATE), err);
+
+	__test_exec_and_rc0(rc, elastic_print_add_string(&ep, test_input),
+			    err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.column_widths[0], rc == 9,
+			     err_destroy_ep);
+
+	/* the widest cell gets narrower */
+	__test_exec_and_rc0(rc, elastic_print_update_line(&ep, 1,
+				"ddd\te\tf\n", 9), err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.column_widths[0], rc == 4,
+			     err_destroy_ep);
+
+	__test_exec_and_expr(
+	    rc,
+	    elastic_print_snput(&ep, test_buffer, __test_update_buffer_length),
+	    rc == (int)strlen(test_buffer_check), err_destroy_ep);
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_destroy_ep);
+	fputs(test_buffer, stdout);
+
+	__test_exec_and_rc0(rc, elastic_print_remove_line(&ep, 1),
+			    err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.lines_count, rc == 2, err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.column_widths[0], rc == 2,
+			     err_destroy_ep);
+	__test_exec_and_expr(rc, (int)elastic_print_measure(&ep),
+			     rc == (int)strlen(test_buffer_check_removed),
+			     err_destroy_ep);
+
+	__test_exec_and_expr(
+	    rc,
+	    elastic_print_snput(&ep, test_buffer, __test_update_buffer_length),
+	    rc == (int)strlen(test_buffer_check_removed), err_destroy_ep);
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check_removed),
+			    err_destroy_ep);
+	fputs(test_buffer, stdout);
+
+	/* only one line at a time, and only existing ones */
+	__test_exec_and_expr(rc, elastic_print_update_line(&ep, 0, "a\nb", 3),
+			     rc == EINVAL, err_destroy_ep);
+	__test_exec_and_expr(rc, elastic_print_remove_line(&ep, 2),
+			     rc == EINVAL, err_destroy_ep);
+
+	elastic_print_destory(&ep);
+
+	/* only instances created for it can be changed */
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 2, 1), err);
+	__test_exec_and_rc0(rc, elastic_print_add_string(&ep, test_input),
+			    err_destroy_ep);
+	__test_exec_and_expr(rc, elastic_print_remove_line(&ep, 0),
+			     rc == EINVAL, err_destroy_ep);
+	elastic_print_destory(&ep);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_update_storage()
+{
+	int rc = 0;
+#define __test_update_storage_rows	10
+#define __test_update_storage_length	(1 << 6)
+#define __test_update_storage_buffer_length	(1 << 12)
+#define __test_update_storage_big	(1 << 16)
+	char test_rows[__test_update_storage_rows][__test_update_storage_length];
+	char test_buffer[__test_update_storage_buffer_length];
+	char test_buffer_check[__test_update_storage_buffer_length];
+	char test_borrowed[] = "borrowed\tline\n";
+	char *big;
+	size_t i, row, storage;
+
+	struct elastic_print ep, ep_check;
+
+	big = malloc(__test_update_storage_big);
+	if (big == NULL) {
+		rc = ENOMEM;
+		goto err;
+	}
+	memset(big, 'x', __test_update_storage_big);
+
+	__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 2, 1,
+				ELASTIC_PRINT_UPDATE), err_free_big);
+
+	for (row = 0; row < __test_update_storage_rows; row++) {
+		snprintf(test_rows[row], __test_update_storage_length,
+			 "row %zu\t0\n", row);
+		__test_exec_and_rc0(rc, elastic_print_add_string(&ep,
+					test_rows[row]), err_destroy_ep);
+	}
+	__test_exec_and_rc0(rc, elastic_print_add_borrowed(&ep, test_borrowed,
+				strlen(test_borrowed)), err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.lines_borrowed, rc == 1,
+			     err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_remove_line(&ep,
+				__test_update_storage_rows), err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.lines_borrowed, rc == 0,
+			     err_destroy_ep);
+	storage = ep.stats.bytes_storage;
+
+	/* a live dashboard, with values that get shorter and longer */
+	for (i = 1; i <= 1000000; i++) {
+		row = (i * 7) % __test_update_storage_rows;
+		if ((i % 1000) == 0) {
+			snprintf(test_rows[row], __test_update_storage_length,
+				 "row %zu\t%zu\t%zu\n", row, i, i % 13);
+		} else {
+			snprintf(test_rows[row], __test_update_storage_length,
+				 "row %zu\t%zu\n", row, (i * 2654435761u) %
+				 ((size_t)1 << (i % 30)));
+		}
+		__test_exec_and_rc0(rc, elastic_print_update_line(&ep, row,
+					test_rows[row], strlen(test_rows[row])),
+				    err_destroy_ep);
+	}
+	__test_exec_and_expr(rc, (int)ep.stats.bytes_storage,
+			     rc <= 2 * (int)storage, err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.cells_count,
+			     rc < 8 * __test_update_storage_rows,
+			     err_destroy_ep);
+
+	/* lines too large for a shared chunk get chunks of their own, which
+	 * are used again once the line is replaced */
+	storage = ep.stats.bytes_storage;
+	for (i = 0; i < 64; i++) {
+		__test_exec_and_rc0(rc, elastic_print_update_line(&ep, 0, big,
+					__test_update_storage_big - i),
+				    err_destroy_ep);
+		__test_exec_and_rc0(rc, elastic_print_update_line(&ep, 0,
+					test_rows[0], strlen(test_rows[0])),
+				    err_destroy_ep);
+	}
+	__test_exec_and_expr(rc, (int)ep.stats.bytes_storage,
+			     rc <= (int)storage + __test_update_storage_big + 1,
+			     err_destroy_ep);
+
+	/* the lines behind a removed one move up */
+	__test_exec_and_rc0(rc, elastic_print_remove_line(&ep, 3),
+			    err_destroy_ep);
+	memmove(test_rows[3], test_rows[4],
+		(__test_update_storage_rows - 4) * sizeof(test_rows[0]));
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep_check, 2, 1),
+			    err_destroy_ep);
+	for (row = 0; row < (__test_update_storage_rows - 1); row++) {
+		__test_exec_and_rc0(rc, elastic_print_add_string(&ep_check,
+					test_rows[row]), err_destroy_ep_check);
+	}
+
+	__test_exec_and_expr(rc, elastic_print_snput(&ep_check,
+				test_buffer_check,
+				__test_update_storage_buffer_length),
+			     rc > 0, err_destroy_ep_check);
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, test_buffer,
+				__test_update_storage_buffer_length),
+			     rc == (int)strlen(test_buffer_check),
+			     err_destroy_ep_check);
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_destroy_ep_check);
+	fputs(test_buffer, stdout);
+
+	elastic_print_destory(&ep_check);
+	elastic_print_destory(&ep);
+	free(big);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep_check:
+	elastic_print_destory(&ep_check);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err_free_big:
+	free(big);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_printf()
+{
+	int rc = 0;
+#define __test_printf_big	(1 << 17)
+#define __test_printf_buffer_length	(1 << 10)
+	char test_buffer[__test_printf_buffer_length];
+	char test_buffer_check[__test_printf_buffer_length];
+	char test_lines[] = "a\tb\r\nccc\td\n\re\tf";
+	char *big, *streamed;
+	size_t i;
+	FILE *test_file;
+
+	struct elastic_print ep, ep_check;
+
+	big = malloc(__test_printf_big + 1);
+	if (big == NULL) {
+		rc = ENOMEM;
+		goto err;
+	}
+	memset(big, 'x', __test_printf_big);
+	big[__test_printf_big] = '\0';
+
+	/* longer than any storage-chunk */
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 1, 1), err_free_big);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep, "%s\t%d", big,
+							 1), err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep, "%d\t%s", 2,
+							 "y"), err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.column_widths[0],
+			     rc == __test_printf_big + 1, err_destroy_ep);
+	__test_exec_and_expr(rc, (int)elastic_print_measure(&ep),
+			     rc == 2 * (__test_printf_big + 1) + 4,
+			     err_destroy_ep);
+	elastic_print_destory(&ep);
+
+	/* more than one line in one call */
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 1, 1), err_free_big);
+	__test_exec_and_rc0(rc, elastic_print_create(&ep_check, 1, 1),
+			    err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep, "%s",
+							 test_lines),
+			    err_destroy_ep_check);
+	__test_exec_and_rc0(rc, elastic_print_add_string(&ep_check,
+							 test_lines),
+			    err_destroy_ep_check);
+	__test_exec_and_expr(rc, (int)ep.lines_count, rc == 3,
+			     err_destroy_ep_check);
+
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, test_buffer,
+					__test_printf_buffer_length),
+			     rc > 0, err_destroy_ep_check);
+	__test_exec_and_expr(rc, elastic_print_snput(&ep_check,
+					test_buffer_check,
+					__test_printf_buffer_length),
+			     rc > 0, err_destroy_ep_check);
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_destroy_ep_check);
+	fputs(test_buffer, stdout);
+
+	elastic_print_destory(&ep_check);
+	elastic_print_destory(&ep);
+
+	/* lines written out in streaming mode while the rest of the same
+	 * call is still to be added */
+	for (i = 0; i < __test_printf_big; i++) {
+		big[i] = ((i % 64) == 63) ? '\n' : 'a' + (char)(i % 26);
+	}
+
+	test_file = tmpfile();
+	if (test_file == NULL) {
+		rc = errno;
+		goto err_free_big;
+	}
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 1, 1),
+			    err_close_file);
+	__test_exec_and_rc0(rc, elastic_print_stream(&ep, fileno(test_file)),
+			    err_destroy_ep_file);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep, "%s", big),
+			    err_destroy_ep_file);
+	__test_exec_and_rc0(rc, elastic_print_stream_finish(&ep),
+			    err_destroy_ep_file);
+
+	streamed = malloc(__test_printf_big + 1);
+	if (streamed == NULL) {
+		rc = ENOMEM;
+		goto err_destroy_ep_file;
+	}
+	rewind(test_file);
+	rc = (fread(streamed, 1, __test_printf_big + 1, test_file) ==
+	      __test_printf_big) ? memcmp(streamed, big, __test_printf_big) : EIO;
+	free(streamed);
+	__test_exec_and_rc0(rc, rc, err_destroy_ep_file);
+
+	elastic_print_destory(&ep);
+	fclose(test_file);
+	free(big);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep_file:
+	elastic_print_destory(&ep);
+err_close_file:
+	fclose(test_file);
+	goto err_free_big;
+err_destroy_ep_check:
+	elastic_print_destory(&ep_check);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err_free_big:
+	free(big);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+/** collects the output of `elastic_print_sinkput()` in test_sink() */
+struct test_sink_ctx
+{
+	char *	buffer;
+	size_t	length;
+	size_t	calls;
+	/** the sink fails after this many calls */
+	size_t	calls_max;
+};
+
+static int test_sink_collect(void *ctx, const char *data, size_t length)
+{
+	struct test_sink_ctx *sink = ctx;
+
+	if (sink->calls == sink->calls_max) {
+		return EPIPE;
+	}
+
+	memcpy(&sink->buffer[sink->length], data, length);
+	sink->length += length;
+	sink->calls += 1;
+
+	return 0;
+}
+
+int test_sink()
+{
+	int rc = 0;
+	char *test_buffer_check;
+	size_t test_buffer_length;
+	int i;
+
+	struct elastic_print ep;
+	struct test_sink_ctx sink = { NULL, 0, 0, SIZE_MAX };
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 1, 1), err);
+
+	/* more than one block, with pieces longer than a block */
+	for (i = 0; i < 10000; i++) {
+		__test_exec_and_rc0(rc, elastic_print_add_printf(&ep,
+					"%d\t%*s\t%d", i, (i % 1000) ? i % 50 :
+					100000, "", i), err_destroy_ep);
+	}
+
+	test_buffer_length = elastic_print_measure(&ep);
+	sink.buffer = malloc(2 * (test_buffer_length + 1));
+	__test_exec_and_expr(rc, (sink.buffer == NULL) ? ENOMEM : 0, rc == 0,
+			     err_destroy_ep);
+	test_buffer_check = &sink.buffer[test_buffer_length + 1];
+
+	__test_exec_and_rc0(rc, elastic_print_sinkput(&ep, test_sink_collect,
+						      &sink), err_free_buffer);
+	__test_exec_and_expr(rc, (int)sink.length,
+			     sink.length == test_buffer_length, err_free_buffer);
+	__test_exec_and_expr(rc, (int)sink.calls,
+			     sink.calls == ((test_buffer_length + 0xffff) >> 16),
+			     err_free_buffer);
+
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, test_buffer_check,
+						    test_buffer_length + 1),
+			     rc == (int)test_buffer_length, err_free_buffer);
+	__test_exec_and_rc0(rc, memcmp(sink.buffer, test_buffer_check,
+				       test_buffer_length),
+			    err_free_buffer);
+
+	/* a failing sink stops the output */
+	sink.length = 0;
+	sink.calls = 0;
+	sink.calls_max = 2;
+	__test_exec_and_expr(rc, elastic_print_sinkput(&ep, test_sink_collect,
+						       &sink),
+			     rc == EPIPE, err_free_buffer);
+	__test_exec_and_expr(rc, (int)sink.length, rc == (2 << 16),
+			     err_free_buffer);
+
+	fprintf(stdout, "%zu bytes\n", test_buffer_length);
+
+	free(sink.buffer);
+	elastic_print_destory(&ep);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_free_buffer:
+	free(sink.buffer);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_stats()
+{
+	int rc = 0;
+	char test_buffer[64];
+
+	struct elastic_print ep;
+	struct elastic_print_stats stats;
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 2, 1), err);
+
+	elastic_print_get_stats(&ep, &stats);
+	__test_exec_and_expr(rc, (int)stats.allocs,
+			     (stats.lines_added == 0) && (stats.renders == 0),
+			     err_destroy_ep);
+
+	__test_exec_and_rc0(rc, elastic_print_add_string(&ep, "a\tbb\nccc\td"),
+			    err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_add_printf(&ep, "%d\t%s", 42, "e"),
+			    err_destroy_ep);
+
+	elastic_print_get_stats(&ep, &stats);
+	__test_exec_and_expr(rc, (int)stats.lines_added,
+			     stats.lines_added == 3, err_destroy_ep);
+	__test_exec_and_expr(rc, (int)stats.bytes_added,
+			     stats.bytes_added == 14, err_destroy_ep);
+	__test_exec_and_expr(rc, (int)stats.bytes_stored,
+			     stats.bytes_stored == 16, err_destroy_ep);
+	__test_exec_and_expr(rc, (int)stats.bytes_storage,
+			     stats.bytes_storage >= stats.bytes_stored,
+			     err_destroy_ep);
+	__test_exec_and_expr(rc, (int)stats.allocs, stats.allocs > 0,
+			     err_destroy_ep);
+
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, test_buffer,
+						    sizeof(test_buffer)),
+			     rc == (int)elastic_print_measure(&ep),
+			     err_destroy_ep);
+
+	elastic_print_get_stats(&ep, &stats);
+	__test_exec_and_expr(rc, (int)stats.renders, stats.renders == 1,
+			     err_destroy_ep);
+	__test_exec_and_expr(rc, (int)stats.bytes_rendered,
+			     stats.bytes_rendered == elastic_print_measure(&ep),
+			     err_destroy_ep);
+
+	__test_exec_and_rc0(rc, elastic_print_stats_fput(&ep, stdout),
+			    err_destroy_ep);
+
+	elastic_print_destory(&ep);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_borrowed()
+{
+	int rc = 0;
+	static const char test_lines[] = "aaa\tb\tcccccc\r\n"
+					 "dd\teeeeee\vee\tf\n"
+					 "\tggggggg\x7f\n"
+					 "hhhh\t\xe4\xb8\x80\ti";
+	char test_copy[sizeof(test_lines)];
+	char test_buffer[256], test_buffer_check[256];
+	unsigned int flags[] = { 0, ELASTIC_PRINT_BLOCKS };
+	size_t i;
+
+	struct elastic_print ep, ep_check;
+	struct elastic_print_stats stats;
+
+	for (i = 0; i < (sizeof(flags) / sizeof(*flags)); i++) {
+		memcpy(test_copy, test_lines, sizeof(test_lines));
+
+		__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 3, 1,
+								   flags[i]),
+				    err);
+		__test_exec_and_rc0(rc, elastic_print_create_flags(&ep_check, 3,
+								   1, flags[i]),
+				    err_destroy_ep);
+
+		__test_exec_and_rc0(rc, elastic_print_add_borrowed(&ep,
+					test_lines, sizeof(test_lines)),
+				    err_destroy_ep_check);
+		__test_exec_and_rc0(rc, elastic_print_add_string(&ep_check,
+								 test_copy),
+				    err_destroy_ep_check);
+
+		/* only the lines with replaced characters are stored */
+		__test_exec_and_expr(rc, (int)ep.lines_count,
+				     (ep.lines_count == 4) &&
+				     (ep.lines[0] == test_lines) &&
+				     (ep.lines[1] != &test_lines[14]) &&
+				     (ep.lines[2] != &test_lines[29]) &&
+				     (ep.lines[3] == &test_lines[39]),
+				     err_destroy_ep_check);
+
+		elastic_print_get_stats(&ep, &stats);
+		__test_exec_and_expr(rc, (int)stats.bytes_borrowed,
+				     (stats.bytes_borrowed == 22) &&
+				     (stats.bytes_stored == 25),
+				     err_destroy_ep_check);
+
+		__test_exec_and_expr(rc, elastic_print_snput(&ep, test_buffer,
+						sizeof(test_buffer)),
+				     rc > 0, err_destroy_ep_check);
+		__test_exec_and_expr(rc, elastic_print_snput(&ep_check,
+						test_buffer_check,
+						sizeof(test_buffer_check)),
+				     rc > 0, err_destroy_ep_check);
+		__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+				    err_destroy_ep_check);
+		fputs(test_buffer, stdout);
+
+		elastic_print_destory(&ep_check);
+		elastic_print_destory(&ep);
+	}
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep_check:
+	elastic_print_destory(&ep_check);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_reset()
+{
+	int rc = 0;
+	char test_buffer[1024], test_buffer_check[1024];
+	unsigned int flags[] = { 0, ELASTIC_PRINT_BLOCKS,
+				 ELASTIC_PRINT_DYNAMIC | ELASTIC_PRINT_UPDATE };
+	size_t i, round, line, allocs = 0;
+	FILE *test_file;
+
+	struct elastic_print ep, ep_check;
+	struct elastic_print_stats stats;
+
+	test_file = fopen("/dev/null", "w");
+	if (test_file == NULL) {
+		rc = errno;
+		goto err;
+	}
+
+	for (i = 0; i < (sizeof(flags) / sizeof(*flags)); i++) {
+		__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 3, 2,
+								   flags[i]),
+				    err_close_file);
+
+		/* the same table, refreshed with other values */
+		for (round = 0; round < 4; round++) {
+			__test_exec_and_rc0(rc, elastic_print_reset(&ep),
+					    err_destroy_ep);
+			__test_exec_and_rc0(rc, elastic_print_create_flags(
+						&ep_check, 3, 2, flags[i]),
+					    err_destroy_ep);
+
+			for (line = 0; line < 20; line++) {
+				__test_exec_and_rc0(rc,
+					elastic_print_add_printf(&ep,
+						"%zu\t%zu\t%s", line,
+						line * (round + 1), "x"),
+					err_destroy_ep_check);
+				__test_exec_and_rc0(rc,
+					elastic_print_add_printf(&ep_check,
+						"%zu\t%zu\t%s", line,
+						line * (round + 1), "x"),
+					err_destroy_ep_check);
+			}
+
+			__test_exec_and_rc0(rc, elastic_print_fput(&ep,
+								   test_file),
+					    err_destroy_ep_check);
+
+			__test_exec_and_expr(rc, elastic_print_snput(&ep,
+						test_buffer,
+						sizeof(test_buffer)),
+					     rc > 0, err_destroy_ep_check);
+			__test_exec_and_expr(rc, elastic_print_snput(&ep_check,
+						test_buffer_check,
+						sizeof(test_buffer_check)),
+					     rc > 0, err_destroy_ep_check);
+			__test_exec_and_rc0(rc, strcmp(test_buffer,
+						       test_buffer_check),
+					    err_destroy_ep_check);
+
+			elastic_print_destory(&ep_check);
+
+			/* after the first round nothing is allocated anymore */
+			elastic_print_get_stats(&ep, &stats);
+			__test_exec_and_expr(rc, (int)stats.allocs,
+					     (round == 0) || (allocs ==
+					      stats.allocs + stats.reallocs),
+					     err_destroy_ep);
+			allocs = stats.allocs + stats.reallocs;
+		}
+
+		fputs(test_buffer, stdout);
+		elastic_print_destory(&ep);
+	}
+
+	/* not in streaming mode */
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 1, 1), err_close_file);
+	__test_exec_and_rc0(rc, elastic_print_stream(&ep, fileno(test_file)),
+			    err_destroy_ep);
+	__test_exec_and_expr(rc, elastic_print_reset(&ep), rc == EINVAL,
+			     err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_stream_finish(&ep),
+			    err_destroy_ep);
+	elastic_print_destory(&ep);
+
+	fclose(test_file);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep_check:
+	elastic_print_destory(&ep_check);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err_close_file:
+	fclose(test_file);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+#define __test_concurrent_threads	4
+#define __test_concurrent_lines		500
+#define __test_concurrent_buffer_length	(1 << 16)
+
+/** one producer of test_concurrent() */
+struct test_concurrent_producer
+{
+	struct elastic_print *	eprint;
+	int			id;
+	int			rc;
+};
+
+static void *test_concurrent_produce(void *arg)
+{
+	struct test_concurrent_producer *producer = arg;
+	char line[64];
+	int i;
+
+	for (i = 0; (producer->rc == 0) && (i < __test_concurrent_lines);
+	     i++) {
+		if (i % 2) {
+			producer->rc = elastic_print_add_printf(
+			    producer->eprint, "t%d\t%d\t%.*s", producer->id, i,
+			    (i * 7) % 23, "xxxxxxxxxxxxxxxxxxxxxxx");
+		} else {
+			snprintf(line, sizeof(line), "t%d\t%d\t%.*s\n",
+				 producer->id, i, (i * 5) % 17,
+				 "yyyyyyyyyyyyyyyyy");
+			producer->rc = elastic_print_add_string(producer->eprint,
+								line);
+		}
+	}
+
+	return NULL;
+}
+
+int test_concurrent()
+{
+	int rc = 0;
+	char *test_buffer, *test_buffer_check, *cur, *next;
+	char line[128], cells[3][32];
+	int next_line[__test_concurrent_threads] = { 0 };
+	int i, id, number;
+	size_t length;
+
+	struct elastic_print ep, ep_check;
+	struct test_concurrent_producer producers[__test_concurrent_threads];
+	pthread_t threads[__test_concurrent_threads];
+
+	test_buffer = malloc(2 * __test_concurrent_buffer_length);
+	if (test_buffer == NULL) {
+		rc = ENOMEM;
+		goto err;
+	}
+	test_buffer_check = &test_buffer[__test_concurrent_buffer_length];
+
+	__test_exec_and_expr(rc, elastic_print_create_flags(&ep, 3, 1,
+				ELASTIC_PRINT_CONCURRENT |
+				ELASTIC_PRINT_BLOCKS),
+			     rc == EINVAL, err_free_buffer);
+	__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 3, 1,
+				ELASTIC_PRINT_CONCURRENT |
+				ELASTIC_PRINT_DYNAMIC),
+			    err_free_buffer);
+
+	for (i = 0; i < __test_concurrent_threads; i++) {
+		producers[i].eprint = &ep;
+		producers[i].id = i;
+		producers[i].rc = 0;
+
+		__test_exec_and_rc0(rc, pthread_create(&threads[i], NULL,
+						       test_concurrent_produce,
+						       &producers[i]),
+				    err_destroy_ep);
+	}
+	for (i = 0; i < __test_concurrent_threads; i++) {
+		pthread_join(threads[i], NULL);
+		__test_exec_and_rc0(rc, producers[i].rc, err_destroy_ep);
+	}
+
+	length = elastic_print_measure(&ep);
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, test_buffer,
+					__test_concurrent_buffer_length),
+			     rc == (int)length, err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.lines_count,
+			     ep.lines_count == (__test_concurrent_threads *
+						__test_concurrent_lines),
+			     err_destroy_ep);
+
+	/* the lines of each thread are in the order it added them; the same
+	 * lines added one after another give the same output */
+	__test_exec_and_rc0(rc, elastic_print_create_flags(&ep_check, 3, 1,
+				ELASTIC_PRINT_DYNAMIC),
+			    err_destroy_ep);
+
+	for (cur = test_buffer; *cur != '\0'; cur = next + 1) {
+		next = strchr(cur, '\n');
+		*next = '\0';
+
+		cells[2][0] = '\0';
+		__test_exec_and_expr(rc, sscanf(cur, "%31s %31s %31s", cells[0],
+						cells[1], cells[2]),
+				     rc >= 2, err_destroy_ep_check);
+		*next = '\n';
+
+		__test_exec_and_expr(rc, sscanf(cells[0], "t%d", &id),
+				     (rc == 1) && (id >= 0) &&
+				     (id < __test_concurrent_threads),
+				     err_destroy_ep_check);
+		number = atoi(cells[1]);
+		__test_exec_and_expr(rc, number, number == next_line[id]++,
+				     err_destroy_ep_check);
+
+		snprintf(line, sizeof(line), "%s\t%s\t%s%s", cells[0],
+			 cells[1], cells[2], (number % 2) ? "" : "\n");
+		__test_exec_and_rc0(rc, elastic_print_add_string(&ep_check,
+								 line),
+				    err_destroy_ep_check);
+	}
+
+	__test_exec_and_expr(rc, elastic_print_snput(&ep_check,
+					test_buffer_check,
+					__test_concurrent_buffer_length),
+			     rc == (int)length, err_destroy_ep_check);
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_buffer_check),
+			    err_destroy_ep_check);
+
+	elastic_print_destory(&ep_check);
+
+	/* the next lines come behind the merged ones */
+	__test_exec_and_rc0(rc, elastic_print_add_string(&ep, "last\t\t"),
+			    err_destroy_ep);
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, test_buffer,
+					__test_concurrent_buffer_length),
+			     rc == (int)elastic_print_measure(&ep),
+			     err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.lines_count,
+			     strncmp(ep.lines[ep.lines_count - 1], "last", 4) ==
+			     0, err_destroy_ep);
+	fputs(&test_buffer[rc - 120], stdout);
+
+	elastic_print_destory(&ep);
+	free(test_buffer);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep_check:
+	elastic_print_destory(&ep_check);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err_free_buffer:
+	free(test_buffer);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_passthrough()
+{
+	int rc = 0;
+	char test_lines[] = "a\tb\r\nccc\td\n\n\re\vf";
+	static const char test_borrowed[] = "g\th\ni";
+	static const char test_expected[] = "a\tb\nccc\td\n\ne f\ng\th\ni\n";
+	char test_buffer[64], *big;
+	size_t length, i;
+	FILE *test_file;
+
+	struct elastic_print ep;
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 0, 1), err);
+
+	/* without any columns the lines are copied as they are */
+	__test_exec_and_rc0(rc, elastic_print_add_string(&ep, test_lines),
+			    err_destroy_ep);
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, test_buffer,
+						    sizeof(test_buffer)),
+			     rc == (int)strlen("a\tb\nccc\td\n\ne f\n"),
+			     err_destroy_ep);
+
+	/* borrowed lines are not followed by a newline in their storage */
+	__test_exec_and_rc0(rc, elastic_print_add_borrowed(&ep, test_borrowed,
+						   strlen(test_borrowed)),
+			    err_destroy_ep);
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, test_buffer,
+						    sizeof(test_buffer)),
+			     rc == (int)strlen(test_expected), err_destroy_ep);
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_expected),
+			    err_destroy_ep);
+	fputs(test_buffer, stdout);
+
+	elastic_print_destory(&ep);
+
+	/* lines in chunks of their own, written with fdput() */
+	length = 3 * (1 << 16);
+	big = malloc(length + 1);
+	if (big == NULL) {
+		rc = ENOMEM;
+		goto err;
+	}
+	for (i = 0; i < length; i++) {
+		big[i] = ((i % 40000) == 39999) ? '\n' : 'a' + (char)(i % 26);
+	}
+	big[length] = '\0';
+
+	test_file = tmpfile();
+	if (test_file == NULL) {
+		rc = errno;
+		goto err_free_big;
+	}
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 0, 1),
+			    err_close_file);
+	__test_exec_and_rc0(rc, elastic_print_add_line(&ep, big, length),
+			    err_destroy_ep_file);
+	__test_exec_and_rc0(rc, elastic_print_add_string(&ep, "x\ny"),
+			    err_destroy_ep_file);
+	__test_exec_and_rc0(rc, elastic_print_fdput(&ep, fileno(test_file)),
+			    err_destroy_ep_file);
+
+	/* the input had no line-break at its end */
+	rewind(test_file);
+	big[length] = '\n';
+	for (i = 0; (i <= length) && (fgetc(test_file) == big[i]); i++) {
+	}
+	__test_exec_and_expr(rc, (int)i, (i == (length + 1)) &&
+			     (fgetc(test_file) == 'x') &&
+			     (fgetc(test_file) == '\n') &&
+			     (fgetc(test_file) == 'y') &&
+			     (fgetc(test_file) == '\n') &&
+			     (fgetc(test_file) == EOF), err_destroy_ep_file);
+
+	elastic_print_destory(&ep);
+	fclose(test_file);
+	free(big);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep_file:
+	elastic_print_destory(&ep);
+err_close_file:
+	fclose(test_file);
+err_free_big:
+	free(big);
+	goto err;
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_ssize()
+{
+	int rc = 0;
+	char test_lines[] = "a\tbb\tc\nddd\te\tf\ng";
+	static const char test_expected[] = "a   bb c\nddd e  f\ng   \n";
+	char test_buffer[64], test_read[64];
+	ssize_t length;
+	FILE *test_file;
+
+	struct elastic_print ep;
+
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 2, 1), err);
+	__test_exec_and_rc0(rc, elastic_print_add_string(&ep, test_lines),
+			    err_destroy_ep);
+
+	length = elastic_print_snput_ssize(&ep, test_buffer,
+					   sizeof(test_buffer));
+	__test_exec_and_expr(rc, (int)length,
+			     length == (ssize_t)strlen(test_expected),
+			     err_destroy_ep);
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_expected),
+			    err_destroy_ep);
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, test_buffer,
+						    sizeof(test_buffer)),
+			     rc == (int)length, err_destroy_ep);
+
+	length = elastic_print_snput_threads_ssize(&ep, test_buffer,
+						   sizeof(test_buffer), 4);
+	__test_exec_and_expr(rc, (int)length,
+			     length == (ssize_t)strlen(test_expected),
+			     err_destroy_ep);
+	__test_exec_and_rc0(rc, strcmp(test_buffer, test_expected),
+			    err_destroy_ep);
+
+	length = elastic_print_snput_ssize(&ep, test_buffer, 4);
+	__test_exec_and_expr(rc, (int)length, length == -ENOMEM,
+			     err_destroy_ep);
+
+	/* an output too long for a size_t (only possible on 32 bit) can
+	 * still be printed into streams */
+	ep.output_overflow = 1;
+	__test_exec_and_expr(rc, 0, elastic_print_measure(&ep) == SIZE_MAX,
+			     err_destroy_ep);
+
+	length = elastic_print_snput_ssize(&ep, test_buffer,
+					   sizeof(test_buffer));
+	__test_exec_and_expr(rc, (int)length,
+			     length == (ssize_t)strlen(test_expected),
+			     err_destroy_ep);
+
+	test_file = tmpfile();
+	if (test_file == NULL) {
+		rc = errno;
+		goto err_destroy_ep;
+	}
+	__test_exec_and_rc0(rc, elastic_print_fput_threads(&ep, test_file, 4),
+			    err_close_file);
+	rewind(test_file);
+	length = (ssize_t)fread(test_read, 1, sizeof(test_read) - 1,
+				test_file);
+	test_read[length] = '\0';
+	__test_exec_and_rc0(rc, strcmp(test_read, test_expected),
+			    err_close_file);
+	fclose(test_file);
+
+	__test_exec_and_rc0(rc, elastic_print_reset(&ep), err_destroy_ep);
+	__test_exec_and_expr(rc, (int)ep.output_overflow,
+			     (rc == 0) && (elastic_print_measure(&ep) == 0),
+			     err_destroy_ep);
+
+	fputs(test_buffer, stdout);
+	elastic_print_destory(&ep);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_close_file:
+	fclose(test_file);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	assert(rc != 0);
+	return rc;
+}
+
+int test_spill()
+{
+	int rc = 0;
+	unsigned int flags[] = { ELASTIC_PRINT_DYNAMIC, ELASTIC_PRINT_BLOCKS };
+	static const char test_borrowed[] = "borrowed\tline\n";
+	static const char test_cells[] = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx";
+	char test_text[] = "a\tb\r\ncc\tdd\n\rlast";
+	char *buffer = NULL, *buffer_check = NULL;
+	size_t i, round, line, length;
+	int pipe_fds[2];
+
+	struct elastic_print ep, ep_check;
+	struct elastic_print_stats stats;
+
+	for (i = 0; i < (sizeof(flags) / sizeof(*flags)); i++) {
+		__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 3, 1,
+								   flags[i]),
+				    err);
+		/* the smallest budget, a single storage-chunk */
+		__test_exec_and_rc0(rc, elastic_print_spill(&ep, 0, NULL),
+				    err_destroy_ep);
+		__test_exec_and_rc0(rc, elastic_print_create_flags(&ep_check, 3,
+								   1, flags[i]),
+				    err_destroy_ep);
+
+		for (round = 0; round < 2; round++) {
+			__test_exec_and_rc0(rc, elastic_print_reset(&ep),
+					    err_destroy_ep_check);
+			__test_exec_and_rc0(rc, elastic_print_reset(&ep_check),
+					    err_destroy_ep_check);
+
+			for (line = 0; line < 4000; line++) {
+				__test_exec_and_rc0(rc,
+					elastic_print_add_printf(&ep,
+						"%zu\t%.*s\t%zu", line,
+						(int)((line + round) % 37),
+						test_cells, line * 7),
+					err_destroy_ep_check);
+				__test_exec_and_rc0(rc,
+					elastic_print_add_printf(&ep_check,
+						"%zu\t%.*s\t%zu", line,
+						(int)((line + round) % 37),
+						test_cells, line * 7),
+					err_destroy_ep_check);
+
+				if ((line % 100) != 0) {
+					continue;
+				}
+
+				/* borrowed lines are copied before they are
+				 * spilled */
+				__test_exec_and_rc0(rc,
+					elastic_print_add_borrowed(&ep,
+						test_borrowed,
+						strlen(test_borrowed)),
+					err_destroy_ep_check);
+				__test_exec_and_rc0(rc,
+					elastic_print_add_borrowed(&ep_check,
+						test_borrowed,
+						strlen(test_borrowed)),
+					err_destroy_ep_check);
+			}
+
+			length = elastic_print_measure(&ep);
+			__test_exec_and_expr(rc, 0, length ==
+					     elastic_print_measure(&ep_check),
+					     err_destroy_ep_check);
+
+			free(buffer);
+			free(buffer_check);
+			buffer = malloc(length + 1);
+			buffer_check = malloc(length + 1);
+			if ((buffer == NULL) || (buffer_check == NULL)) {
+				rc = ENOMEM;
+				goto err_destroy_ep_check;
+			}
+
+			__test_exec_and_expr(rc, elastic_print_snput(&ep,
+						buffer, length + 1),
+					     rc == (int)length,
+					     err_destroy_ep_check);
+			__test_exec_and_expr(rc, elastic_print_snput(&ep_check,
+						buffer_check, length + 1),
+					     rc == (int)length,
+					     err_destroy_ep_check);
+			__test_exec_and_rc0(rc, strcmp(buffer, buffer_check),
+					    err_destroy_ep_check);
+
+			/* one more line, the buffer then only gets the start
+			 * of the output */
+			__test_exec_and_rc0(rc, elastic_print_add_borrowed(&ep,
+						test_borrowed,
+						strlen(test_borrowed)),
+					    err_destroy_ep_check);
+			__test_exec_and_rc0(rc, elastic_print_add_borrowed(
+						&ep_check, test_borrowed,
+						strlen(test_borrowed)),
+					    err_destroy_ep_check);
+
+			memset(buffer, 0, length + 1);
+			__test_exec_and_expr(rc, elastic_print_snput_threads(&ep,
+						buffer, length + 1, 4),
+					     rc == -ENOMEM,
+					     err_destroy_ep_check);
+			__test_exec_and_expr(rc, (int)strlen(buffer),
+					     rc <= (int)length,
+					     err_destroy_ep_check);
+			__test_exec_and_rc0(rc, strncmp(buffer, buffer_check,
+							strlen(buffer)),
+					    err_destroy_ep_check);
+		}
+
+		elastic_print_get_stats(&ep, &stats);
+		__test_exec_and_expr(rc, (int)stats.bytes_spilled,
+				     stats.bytes_spilled > (1 << 16),
+				     err_destroy_ep_check);
+
+		/* only empty instances can spill, and not stream then */
+		__test_exec_and_expr(rc, elastic_print_spill(&ep_check, 0, NULL),
+				     rc == EINVAL, err_destroy_ep_check);
+		__test_exec_and_expr(rc, elastic_print_stream(&ep, 1),
+				     rc == EINVAL, err_destroy_ep_check);
+
+		elastic_print_destory(&ep_check);
+		elastic_print_destory(&ep);
+	}
+
+	__test_exec_and_rc0(rc, elastic_print_create_flags(&ep, 0, 1,
+						ELASTIC_PRINT_UPDATE),
+			    err);
+	__test_exec_and_expr(rc, elastic_print_spill(&ep, 0, NULL),
+			     rc == EINVAL, err_destroy_ep);
+	elastic_print_destory(&ep);
+
+	/* input that is not a regular file is read in pieces of lines */
+	__test_exec_and_rc0(rc, elastic_print_create(&ep, 2, 1), err);
+	__test_exec_and_rc0(rc, elastic_print_spill(&ep, 0, NULL),
+			    err_destroy_ep);
+	__test_exec_and_rc0(rc, elastic_print_create(&ep_check, 2, 1),
+			    err_destroy_ep);
+
+	if (pipe(pipe_fds) != 0) {
+		rc = errno;
+		goto err_destroy_ep_check;
+	}
+	if (write(pipe_fds[1], test_text, strlen(test_text)) !=
+	    (ssize_t)strlen(test_text)) {
+		rc = EIO;
+		close(pipe_fds[0]);
+		close(pipe_fds[1]);
+		goto err_destroy_ep_check;
+	}
+	close(pipe_fds[1]);
+
+	rc = elastic_print_add_fd(&ep, pipe_fds[0], 0);
+	close(pipe_fds[0]);
+	__test_exec_and_rc0(rc, rc, err_destroy_ep_check);
+	__test_exec_and_rc0(rc, elastic_print_add_string(&ep_check, test_text),
+			    err_destroy_ep_check);
+
+	free(buffer);
+	free(buffer_check);
+	buffer = malloc(64);
+	buffer_check = malloc(64);
+	if ((buffer == NULL) || (buffer_check == NULL)) {
+		rc = ENOMEM;
+		goto err_destroy_ep_check;
+	}
+
+	__test_exec_and_expr(rc, elastic_print_snput(&ep, buffer, 64), rc > 0,
+			     err_destroy_ep_check);
+	__test_exec_and_expr(rc, elastic_print_snput(&ep_check, buffer_check,
+						    64),
+			     rc > 0, err_destroy_ep_check);
+	__test_exec_and_rc0(rc, strcmp(buffer, buffer_check),
+			    err_destroy_ep_check);
+	fputs(buffer, stdout);
+
+	elastic_print_destory(&ep_check);
+	elastic_print_destory(&ep);
+	free(buffer);
+	free(buffer_check);
+
+/* out: */
+	rc = 0;
+	return rc;
+err_destroy_ep_check:
+	elastic_print_destory(&ep_check);
+err_destroy_ep:
+	elastic_print_destory(&ep);
+err:
+	free(buffer);
+	free(buffer_check);
+	assert(rc != 0);
+	return rc;
+}
+
+int
+main()
+{
+	int rc = 0;
+
+	fprintf(stdout, "running test 'test_basic()' .. \n");
+	__test_exec_and_rc0(rc, test_basic(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_zero_columns()' .. \n");
+	__test_exec_and_rc0(rc, test_zero_columns(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_measure()' .. \n");
+	__test_exec_and_rc0(rc, test_measure(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_fdput()' .. \n");
+	__test_exec_and_rc0(rc, test_fdput(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_stream()' .. \n");
+	__test_exec_and_rc0(rc, test_stream(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_blocks()' .. \n");
+	__test_exec_and_rc0(rc, test_blocks(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_dynamic()' .. \n");
+	__test_exec_and_rc0(rc, test_dynamic(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_utf8()' .. \n");
+	__test_exec_and_rc0(rc, test_utf8(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_bulk()' .. \n");
+	__test_exec_and_rc0(rc, test_bulk(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_render()' .. \n");
+	__test_exec_and_rc0(rc, test_render(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_update()' .. \n");
+	__test_exec_and_rc0(rc, test_update(), err);
+
+	fprintf(stdout, "running test 'test_update_storage()' .. \n");
+	__test_exec_and_rc0(rc, test_update_storage(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_printf()' .. \n");
+	__test_exec_and_rc0(rc, test_printf(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_sink()' .. \n");
+	__test_exec_and_rc0(rc, test_sink(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_stats()' .. \n");
+	__test_exec_and_rc0(rc, test_stats(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_borrowed()' .. \n");
+	__test_exec_and_rc0(rc, test_borrowed(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_reset()' .. \n");
+	__test_exec_and_rc0(rc, test_reset(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_concurrent()' .. \n");
+	__test_exec_and_rc0(rc, test_concurrent(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_passthrough()' .. \n");
+	__test_exec_and_rc0(rc, test_passthrough(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_ssize()' .. \n");
+	__test_exec_and_rc0(rc, test_ssize(), err);
+
+	fputs("\n", stdout);
+
+	fprintf(stdout, "running test 'test_spill()' .. \n");
+	__test_exec_and_rc0(rc, test_spill(), err);
+
+	return EXIT_SUCCESS;
+err:
+	return EXIT_FAILURE;
+}